@@ -0,0 +1,209 @@
+#include <co_async/async_loop.hpp>
+#include <co_async/connect_any.hpp>
+#include <co_async/dns_resolver.hpp>
+#include <co_async/socket.hpp>
+#include <co_async/udp.hpp>
+#include <co_async/when_all.hpp>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std::literals;
+using namespace co_async;
+
+// 对本地桩 DNS 服务器测量 DnsResolver：冷查询、命中缓存、并发同名查询，
+// 并校验否定缓存、畸形应答包被忽略，以及 connect_host 经解析后建立连接。
+// 桩服务器在子进程中运行，*.test 解析为 127.0.0.1 与 ::1，
+// missing.test 返回 NXDOMAIN，v4only.test 的 AAAA 查询返回 TTL 为 0 的
+// SOA (NODATA)；每个正常应答前先回一个截短的垃圾包
+
+using Clock = std::chrono::steady_clock;
+
+static std::string stubReply(std::string_view query) {
+    std::string res;
+    if (query.size() < 12) {
+        return res;
+    }
+    std::size_t pos = 12;
+    std::string name;
+    while (pos < query.size() && query[pos] != 0) {
+        std::size_t len = (std::uint8_t)query[pos];
+        if (!name.empty()) {
+            name += '.';
+        }
+        name.append(query.substr(pos + 1, len));
+        pos += 1 + len;
+    }
+    pos += 1;
+    if (pos + 4 > query.size()) {
+        return res;
+    }
+    std::uint16_t type = (std::uint8_t)query[pos] << 8 |
+                         (std::uint8_t)query[pos + 1];
+    std::string_view question = query.substr(12, pos + 4 - 12);
+    bool missing = name == "missing.test";
+    bool noData = name == "v4only.test" && type == 28;
+    bool answer = !missing && !noData && (type == 1 || type == 28);
+    auto putU16 = [&](std::uint16_t v) {
+        res.push_back((char)(v >> 8));
+        res.push_back((char)(v & 0xff));
+    };
+    res.append(query.substr(0, 2));
+    putU16(missing ? 0x8183 : 0x8180);
+    putU16(1);
+    putU16(answer ? 1 : 0);
+    putU16(noData ? 1 : 0);
+    putU16(0);
+    res.append(question);
+    if (answer) {
+        putU16(0xc00c);
+        putU16(type);
+        putU16(1);
+        putU16(0);
+        putU16(300);
+        if (type == 1) {
+            putU16(4);
+            res.append("\x7f\x00\x00\x01", 4);
+        } else {
+            putU16(16);
+            res.append(15, '\0');
+            res.push_back('\x01');
+        }
+    }
+    if (noData) {
+        putU16(0xc00c);
+        putU16(6);
+        putU16(1);
+        putU16(0);
+        putU16(0);
+        putU16(22);
+        res.append(2, '\0');
+        res.append(20, '\0');
+    }
+    return res;
+}
+
+static Task<> stubServer(AsyncLoop &loop, AsyncFile &sock) {
+    UdpBatch in(64), out(128);
+    while (true) {
+        co_await recv_batch(loop, sock, in);
+        out.clear();
+        for (std::size_t i = 0; i < in.size(); ++i) {
+            auto reply = stubReply({in.data(i).data(), in.data(i).size()});
+            if (reply.empty()) {
+                continue;
+            }
+            out.push(std::string_view(reply).substr(0, 5), in.address(i));
+            out.push(reply, in.address(i));
+        }
+        co_await send_batch(loop, sock, out);
+    }
+}
+
+[[noreturn]] static void runStub(AsyncFile sock) {
+    AsyncLoop loop;
+    run_task(loop, stubServer(loop, sock));
+    std::_Exit(0);
+}
+
+static void check(bool ok, char const *what) {
+    if (!ok) {
+        std::fprintf(stderr, "check failed: %s\n", what);
+        std::exit(1);
+    }
+}
+
+template <class F>
+static Task<> measure(char const *name, std::size_t n, F f) {
+    auto t0 = Clock::now();
+    for (std::size_t i = 0; i < n; ++i) {
+        co_await f(i);
+    }
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - t0)
+                    .count() /
+                n;
+    std::printf("%-16s %8zu %12.2f\n", name, n, us);
+}
+
+static Task<> amain(AsyncLoop &loop, SocketAddress stub, pid_t child) {
+    DnsResolverOptions options;
+    options.mTimeout = 1s;
+    DnsResolver resolver(loop, {stub}, options);
+
+    auto addrs = co_await resolver.resolve("www.example.test");
+    check(addrs.size() == 2, "A and AAAA answers");
+    check(addrs[0].mAddr.index() == 1 && addrs[1].mAddr.index() == 0,
+          "IPv6 first");
+
+    bool notFound = false;
+    try {
+        co_await resolver.resolve("missing.test");
+    } catch (std::invalid_argument const &) {
+        notFound = true;
+    }
+    check(notFound, "NXDOMAIN");
+    check(resolver.cacheSize() == 2, "negative answer cached");
+
+    std::printf("%-16s %8s %12s\n", "case", "lookups", "us/op");
+    std::size_t const kCold = 200;
+    co_await measure("cold", kCold, [&](std::size_t i) -> Task<> {
+        auto name = "host" + std::to_string(i) + ".test";
+        auto res = co_await resolver.resolve(std::move(name));
+        check(res.size() == 2, "cold answer");
+    });
+    co_await measure("cached", 100000, [&](std::size_t i) -> Task<> {
+        auto name = "host" + std::to_string(i % kCold) + ".test";
+        auto res = co_await resolver.resolve(std::move(name));
+        check(res.size() == 2, "cached answer");
+    });
+    co_await measure("concurrent x64", 50, [&](std::size_t i) -> Task<> {
+        auto name = "fanout" + std::to_string(i) + ".test";
+        std::vector<Task<std::vector<IpAddress>>> tasks;
+        for (std::size_t j = 0; j < 64; ++j) {
+            tasks.push_back(resolver.resolve(name));
+        }
+        auto res = co_await when_all(tasks);
+        check(res.back().size() == 2, "deduplicated answer");
+    });
+
+    // ::1 上没有监听，connect_host 应在其被拒绝后改连 127.0.0.1
+    auto listenAddr = socket_address(ip_address("127.0.0.1"), 0);
+    AsyncFile listener(
+        checkError(socket(listenAddr.mAddr.ss_family, SOCK_STREAM, 0)));
+    socketBind(listener, listenAddr);
+    listenAddr = socketGetAddress(listener);
+    int port = ntohs(((sockaddr_in const &)listenAddr.mAddr).sin_port);
+    auto conn = co_await connect_host(loop, resolver, "app.test", port);
+    check(conn.fileNo() != -1, "connect_host");
+    std::printf("connect_host: ok\n");
+
+    // AAAA 的否定应答不应缩短 A 记录的缓存时间：停掉桩服务器后仍能命中缓存
+    co_await resolver.resolve("v4only.test");
+    kill(child, SIGTERM);
+    waitpid(child, nullptr, 0);
+    auto cached = co_await resolver.resolve("v4only.test");
+    check(cached.size() == 1, "positive ttl kept despite NODATA");
+}
+
+int main() {
+    auto addr = socket_address(ip_address("127.0.0.1"), 0);
+    auto sock = create_udp_server(addr);
+    addr = socketGetAddress(sock);
+    pid_t child = checkError(fork());
+    if (child == 0) {
+        runStub(std::move(sock));
+    }
+    AsyncLoop loop;
+    run_task(loop, amain(loop, addr, child));
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <co_async/expected.hpp>
+#include <co_async/noop_loop.hpp>
+#include <co_async/stream.hpp>
+#include <co_async/task.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+using namespace std::literals;
+using namespace co_async;
+
+// 在三层协程之下读到 EOF：getline 抛出 EOFException 逐层重新抛出，
+// try_getline 把 EndOfFile 作为返回值逐层传回，比较两者每次调用的开销
+
+static Task<std::size_t> throwingLeaf(StringIStream &s) {
+    auto line = co_await s.getline();
+    co_return line.size();
+}
+
+static Task<std::size_t> throwingMiddle(StringIStream &s) {
+    co_return co_await throwingLeaf(s);
+}
+
+static Task<std::size_t> throwingTop(StringIStream &s) {
+    try {
+        co_return co_await throwingMiddle(s);
+    } catch (EOFException const &) {
+        co_return 0;
+    }
+}
+
+static Task<Expected<std::size_t>> expectedLeaf(StringIStream &s) {
+    auto line = co_await s.try_getline();
+    if (!line) {
+        co_return line.error();
+    }
+    co_return line->size();
+}
+
+static Task<Expected<std::size_t>> expectedMiddle(StringIStream &s) {
+    co_return co_await expectedLeaf(s);
+}
+
+static Task<std::size_t> expectedTop(StringIStream &s) {
+    auto res = co_await expectedMiddle(s);
+    co_return res ? *res : 0;
+}
+
+static volatile std::size_t sink = 0;
+
+template <class F>
+static double measure(F &&f) {
+    std::size_t rounds = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    auto t1 = t0;
+    do {
+        sink = sink + f();
+        ++rounds;
+        t1 = std::chrono::steady_clock::now();
+    } while (t1 - t0 < 300ms);
+    return std::chrono::duration<double, std::micro>(t1 - t0).count() /
+           double(rounds);
+}
+
+int main() {
+    NoopLoop loop;
+    // 最后一行没有换行符，读完即到达 EOF
+    auto input = "no newline at end"s;
+    auto throwing = measure([&] {
+        StringIStream s(input);
+        return run_task(loop, throwingTop(s));
+    });
+    auto expected = measure([&] {
+        StringIStream s(input);
+        return run_task(loop, expectedTop(s));
+    });
+    std::printf("%-24s %10s\n", "eof 3 frames deep", "us/call");
+    std::printf("%-24s %10.2f\n", "getline (exception)", throwing);
+    std::printf("%-24s %10.2f\n", "try_getline (Expected)", expected);
+    return 0;
+}
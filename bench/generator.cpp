@@ -0,0 +1,148 @@
+#include <co_async/batch_generator.hpp>
+#include <co_async/generator.hpp>
+#include <co_async/noop_loop.hpp>
+#include <co_async/task.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <span>
+#include <string>
+
+using namespace std::literals;
+using namespace co_async;
+
+// 字节流解析：从按行分隔的十进制数中求和。比较生成器逐个 co_yield、
+// 成批 co_yield 与整块 co_yield 时，逐字节或整批消费的开销
+
+static std::string makeInput(std::size_t bytes) {
+    std::string s;
+    std::uint32_t x = 12345;
+    while (s.size() < bytes) {
+        x = x * 1103515245 + 12345;
+        s += std::to_string(x % 1000000);
+        s += '\n';
+    }
+    return s;
+}
+
+static std::uint64_t parsePlain(std::string const &input) {
+    std::uint64_t sum = 0, num = 0;
+    for (char c: input) {
+        if (c == '\n') {
+            sum += num;
+            num = 0;
+        } else {
+            num = num * 10 + (c - '0');
+        }
+    }
+    return sum;
+}
+
+static Generator<char> bytesOf(std::string const &input) {
+    for (char c: input) {
+        co_yield c;
+    }
+}
+
+static BatchGenerator<char> batchBytesOf(std::string const &input) {
+    for (char c: input) {
+        co_yield c;
+    }
+}
+
+// 模拟从流中按块读入：每块整块交出，不逐字节 co_yield
+static BatchGenerator<char> chunksOf(std::string &input) {
+    for (std::size_t i = 0; i < input.size(); i += 4096) {
+        co_yield std::span<char>(input).subspan(
+            i, std::min<std::size_t>(4096, input.size() - i));
+    }
+}
+
+// 对两种生成器使用同一份逐字节的解析代码
+template <class G>
+static Task<std::uint64_t> parseEach(G gen) {
+    std::uint64_t sum = 0, num = 0;
+    while (auto c = co_await gen) {
+        if (*c == '\n') {
+            sum += num;
+            num = 0;
+        } else {
+            num = num * 10 + (*c - '0');
+        }
+    }
+    co_return sum;
+}
+
+static Task<std::uint64_t> parseBatch(BatchGenerator<char> gen) {
+    std::uint64_t sum = 0, num = 0;
+    while (true) {
+        std::span<char> batch = co_await gen.batch();
+        if (batch.empty()) {
+            break;
+        }
+        for (char c: batch) {
+            if (c == '\n') {
+                sum += num;
+                num = 0;
+            } else {
+                num = num * 10 + (c - '0');
+            }
+        }
+    }
+    co_return sum;
+}
+
+static volatile std::uint64_t sink = 0;
+
+template <class F>
+static double measure(std::size_t bytes, F &&f) {
+    std::size_t rounds = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    auto t1 = t0;
+    do {
+        sink = sink + f();
+        ++rounds;
+        t1 = std::chrono::steady_clock::now();
+    } while (t1 - t0 < 300ms);
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() /
+           double(rounds * bytes);
+}
+
+int main() {
+    std::string input = makeInput(4 << 20);
+    NoopLoop loop;
+    std::uint64_t expect = parsePlain(input);
+    if (run_task(loop, parseEach(bytesOf(input))) != expect ||
+        run_task(loop, parseEach(batchBytesOf(input))) != expect ||
+        run_task(loop, parseBatch(batchBytesOf(input))) != expect ||
+        run_task(loop, parseEach(chunksOf(input))) != expect ||
+        run_task(loop, parseBatch(chunksOf(input))) != expect) {
+        std::printf("mismatch\n");
+        return 1;
+    }
+    double plain = measure(input.size(), [&] { return parsePlain(input); });
+    std::printf("%-22s %10s %10s\n", "parser", "ns/byte", "vs plain");
+    auto report = [&](char const *name, double ns) {
+        std::printf("%-22s %10.3f %9.2fx\n", name, ns, ns / plain);
+    };
+    report("plain loop", plain);
+    report("Generator each", measure(input.size(), [&] {
+               return run_task(loop, parseEach(bytesOf(input)));
+           }));
+    report("BatchGenerator each", measure(input.size(), [&] {
+               return run_task(loop, parseEach(batchBytesOf(input)));
+           }));
+    report("BatchGenerator batch", measure(input.size(), [&] {
+               return run_task(loop, parseBatch(batchBytesOf(input)));
+           }));
+    report("chunked each", measure(input.size(), [&] {
+               return run_task(loop, parseEach(chunksOf(input)));
+           }));
+    report("chunked batch", measure(input.size(), [&] {
+               return run_task(loop, parseBatch(chunksOf(input)));
+           }));
+    return 0;
+}
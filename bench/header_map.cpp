@@ -0,0 +1,129 @@
+#include <co_async/simple_map.hpp>
+#include <co_async/http.hpp>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+using namespace co_async;
+
+// 对比 SimpleMap (std::map)、FlatMap 与 HTTPHeaders (FlatMap 加已知头部编号)
+// 在常见头部数量下建表与查找的耗时
+
+static std::string_view const kHeaders[][2] = {
+    {"host", "www.example.com"},
+    {"user-agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36"},
+    {"accept", "text/html,application/xhtml+xml,application/xml;q=0.9"},
+    {"accept-language", "en-US,en;q=0.9"},
+    {"accept-encoding", "gzip, deflate, br"},
+    {"connection", "keep-alive"},
+    {"referer", "https://www.example.com/products/list?page=2"},
+    {"cookie", "session=8f2d1c0b9a7e6f5d4c3b2a1908f7e6d5; theme=dark"},
+    {"cache-control", "max-age=0"},
+    {"sec-fetch-dest", "document"},
+    {"sec-fetch-mode", "navigate"},
+    {"sec-fetch-site", "same-origin"},
+    {"sec-fetch-user", "?1"},
+    {"upgrade-insecure-requests", "1"},
+    {"if-none-match", "\"670fb3a0-bc55\""},
+    {"if-modified-since", "Thu, 16 Oct 2026 12:34:56 GMT"},
+    {"x-request-id", "5b7c1e2a-94f3-4d1c-8b6e-2f0a9c3d7e11"},
+    {"x-forwarded-for", "203.0.113.7"},
+    {"x-forwarded-proto", "https"},
+    {"dnt", "1"},
+    {"pragma", "no-cache"},
+    {"te", "trailers"},
+    {"priority", "u=0, i"},
+    {"origin", "https://www.example.com"},
+};
+
+static std::string_view const kLookups[] = {
+    "host", "connection", "content-length", "cookie", "transfer-encoding",
+};
+
+static HTTPHeaderId const kLookupIds[] = {
+    HTTPHeaderId::Host,   HTTPHeaderId::Connection,
+    HTTPHeaderId::ContentLength, HTTPHeaderId::Cookie,
+    HTTPHeaderId::TransferEncoding,
+};
+
+template <class F>
+static double measure(F &&f) {
+    std::size_t rounds = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    auto t1 = t0;
+    do {
+        for (int i = 0; i < 1000; ++i) {
+            f();
+        }
+        rounds += 1000;
+        t1 = std::chrono::steady_clock::now();
+    } while (t1 - t0 < 300ms);
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / rounds;
+}
+
+struct Result {
+    double build;
+    double lookup;
+    double lookupId = 0;
+};
+
+template <class Map>
+static Result run(std::size_t n) {
+    volatile std::size_t sink = 0;
+    double build = measure([&] {
+        Map map;
+        for (std::size_t i = 0; i < n; ++i) {
+            map.insert_or_assign(std::string(kHeaders[i][0]),
+                                 std::string(kHeaders[i][1]));
+        }
+        sink = sink + map.contains("host");
+    });
+    Map map;
+    for (std::size_t i = 0; i < n; ++i) {
+        map.insert_or_assign(std::string(kHeaders[i][0]),
+                             std::string(kHeaders[i][1]));
+    }
+    double lookup = measure([&] {
+        for (auto key: kLookups) {
+            if (auto *v = map.at(key)) {
+                sink = sink + v->size();
+            }
+        }
+    });
+    Result res{build, lookup / std::size(kLookups)};
+    if constexpr (std::is_same_v<Map, HTTPHeaders>) {
+        res.lookupId = measure([&] {
+                           for (auto id: kLookupIds) {
+                               if (auto *v = map.at(id)) {
+                                   sink = sink + v->size();
+                               }
+                           }
+                       }) /
+                       std::size(kLookupIds);
+    }
+    return res;
+}
+
+int main() {
+    using Tree = SimpleMap<std::string, std::string>;
+    using Flat = FlatMap<std::string, std::string, 16, HTTPKeyEqual>;
+    std::printf("%-8s %7s %12s %12s %12s\n", "map", "headers", "build ns",
+                "lookup ns", "by id ns");
+    for (std::size_t n: {4, 8, 12, 16, 24}) {
+        auto tree = run<Tree>(n);
+        auto flat = run<Flat>(n);
+        auto headers = run<HTTPHeaders>(n);
+        std::printf("%-8s %7zu %12.1f %12.1f %12s\n", "std::map", n,
+                    tree.build, tree.lookup, "-");
+        std::printf("%-8s %7zu %12.1f %12.1f %12s\n", "flat", n, flat.build,
+                    flat.lookup, "-");
+        std::printf("%-8s %7zu %12.1f %12.1f %12.1f\n", "headers", n,
+                    headers.build, headers.lookup, headers.lookupId);
+    }
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include <co_async/async_loop.hpp>
+#include <co_async/http_server.hpp>
+#include <co_async/socket.hpp>
+#include <co_async/tcp_server.hpp>
+#include <co_async/when_all.hpp>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std::literals;
+using namespace co_async;
+
+// 类似 wrk 的压测：N 条 keep-alive 连接各自串行地发请求，统计吞吐与延迟分位数；
+// 不指定目标时在子进程中启动内置的 HTTPServer
+//
+//   bench_http_server [-c connections] [-d seconds] [-u uri] [host port]
+
+using Clock = std::chrono::steady_clock;
+
+struct Stats {
+    std::vector<std::uint32_t> mLatency; // 微秒
+    std::size_t mErrors = 0;
+};
+
+static Task<HTTPResponse> helloHandler(HTTPRequest &,
+                                       HTTPRouteParams const &) {
+    HTTPResponse res;
+    res.status = 200;
+    res.headers.insert_or_assign("content-type", "text/plain");
+    res.body = "Hello, World!\n";
+    co_return res;
+}
+
+static Task<HTTPResponse> userHandler(HTTPRequest &,
+                                      HTTPRouteParams const &params) {
+    HTTPResponse res;
+    res.status = 200;
+    res.headers.insert_or_assign("content-type", "application/json");
+    res.body = "{\"id\":\"";
+    res.body += params.get("id").value_or("");
+    res.body += "\"}\n";
+    co_return res;
+}
+
+[[noreturn]] static void runServer(AsyncFile listener) {
+    AsyncLoop loop;
+    HTTPServer http(loop);
+    http.route("GET", "/", helloHandler);
+    http.route("GET", "/users/:id", userHandler);
+    TcpServer server(loop, std::move(listener));
+    run_task(loop, http.serve(server));
+    std::_Exit(0);
+}
+
+static Task<> loadConnection(AsyncLoop &loop, SocketAddress const &addr,
+                             std::string const &request, Clock::time_point end,
+                             Stats &stats) {
+    try {
+        FileStream sock(loop, co_await create_tcp_client(loop, addr));
+        HTTPParser<> parser(HTTPParser<>::Response);
+        while (Clock::now() < end) {
+            auto t0 = Clock::now();
+            struct iovec iov[1];
+            iov[0].iov_base = const_cast<char *>(request.data());
+            iov[0].iov_len = request.size();
+            co_await socket_writev(loop, sock.mFile, iov);
+            co_await parser.read_from(sock);
+            std::size_t len = parser.contentLength().value_or(0);
+            if (parser.status() != 200) {
+                ++stats.mErrors;
+            }
+            while (len != 0) {
+                auto buf = sock.peekBuffer();
+                if (buf.empty()) {
+                    bool filled = co_await sock.fillMore();
+                    (void)filled;
+                    continue;
+                }
+                std::size_t n = std::min(len, buf.size());
+                sock.consumeBuffer(n);
+                len -= n;
+            }
+            stats.mLatency.push_back(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    Clock::now() - t0)
+                    .count());
+        }
+    } catch (...) {
+        ++stats.mErrors;
+    }
+}
+
+static Task<> loadRange(AsyncLoop &loop, SocketAddress const &addr,
+                        std::string const &request, Clock::time_point end,
+                        Stats &stats, std::size_t n) {
+    if (n == 1) {
+        co_await loadConnection(loop, addr, request, end, stats);
+    } else if (n > 1) {
+        co_await when_all(loadRange(loop, addr, request, end, stats, n / 2),
+                          loadRange(loop, addr, request, end, stats, n - n / 2));
+    }
+}
+
+static std::uint32_t percentile(std::vector<std::uint32_t> const &sorted,
+                                double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    std::size_t i = static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+int main(int argc, char **argv) {
+    std::size_t connections = 64;
+    int seconds = 5;
+    std::string uri = "/";
+    int opt;
+    while ((opt = getopt(argc, argv, "c:d:u:")) != -1) {
+        switch (opt) {
+        case 'c': connections = std::strtoul(optarg, nullptr, 10); break;
+        case 'd': seconds = std::atoi(optarg); break;
+        case 'u': uri = optarg; break;
+        default:
+            std::fprintf(stderr,
+                         "usage: %s [-c connections] [-d seconds] [-u uri] "
+                         "[host port]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+    std::string host = "127.0.0.1";
+    pid_t child = -1;
+    SocketAddress addr;
+    if (optind + 2 <= argc) {
+        host = argv[optind];
+        addr = socket_address(ip_address(argv[optind]),
+                              std::atoi(argv[optind + 1]));
+    } else {
+        // 先在父进程中监听随机端口，子进程继承后即可接受连接，无需等待
+        addr = socket_address(ip_address(host.c_str()), 0);
+        AsyncFile listener(
+            checkError(socket(addr.mAddr.ss_family, SOCK_STREAM, 0)));
+        socketBind(listener, addr);
+        addr.mAddrLen = sizeof(addr.mAddr);
+        checkError(getsockname(listener.fileNo(), (sockaddr *)&addr.mAddr,
+                               &addr.mAddrLen));
+        child = checkError(fork());
+        if (child == 0) {
+            runServer(std::move(listener));
+        }
+    }
+
+    std::string request = "GET " + uri +
+                          " HTTP/1.1\r\n"
+                          "host: " +
+                          host +
+                          "\r\n"
+                          "user-agent: co_async-bench\r\n"
+                          "\r\n";
+    AsyncLoop loop;
+    Stats stats;
+    auto t0 = Clock::now();
+    auto end = t0 + std::chrono::seconds(seconds);
+    run_task(loop, loadRange(loop, addr, request, end, stats, connections));
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    if (child > 0) {
+        kill(child, SIGTERM);
+        waitpid(child, nullptr, 0);
+    }
+
+    auto &lat = stats.mLatency;
+    std::sort(lat.begin(), lat.end());
+    std::printf("%zu connections, %.2fs, %s %s\n", connections, secs,
+                host.c_str(), uri.c_str());
+    std::printf("requests: %zu, errors: %zu, rps: %.0f\n", lat.size(),
+                stats.mErrors, lat.size() / secs);
+    std::printf("latency us: p50 %u  p90 %u  p99 %u  p99.9 %u  max %u\n",
+                percentile(lat, 0.5), percentile(lat, 0.9),
+                percentile(lat, 0.99), percentile(lat, 0.999),
+                lat.empty() ? 0u : lat.back());
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <co_async/simd_scan.hpp>
+#include <co_async/http_parser.hpp>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+using namespace co_async;
+
+static std::string_view const kCorpus[] = {
+    // 浏览器请求
+    "GET /static/js/app.3f9a1c.js HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, "
+    "like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/"
+    "avif,image/webp,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.9,zh-CN;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Referer: https://www.example.com/products/list?page=2&sort=price\r\n"
+    "Cookie: session=8f2d1c0b9a7e6f5d4c3b2a1908f7e6d5; theme=dark; "
+    "_ga=GA1.2.1234567890.1700000000; _gid=GA1.2.987654321.1700000000\r\n"
+    "Connection: keep-alive\r\n"
+    "Sec-Fetch-Dest: script\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "\r\n"sv,
+    // 反向代理后的静态资源响应
+    "HTTP/1.1 200 OK\r\n"
+    "Server: nginx/1.24.0\r\n"
+    "Date: Sat, 18 Oct 2026 08:00:00 GMT\r\n"
+    "Content-Type: application/javascript; charset=utf-8\r\n"
+    "Content-Length: 48213\r\n"
+    "Last-Modified: Thu, 16 Oct 2026 12:34:56 GMT\r\n"
+    "Connection: keep-alive\r\n"
+    "ETag: \"670fb3a0-bc55\"\r\n"
+    "Cache-Control: public, max-age=31536000, immutable\r\n"
+    "Accept-Ranges: bytes\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "\r\n"sv,
+    // 内部 API 响应
+    "HTTP/1.1 200 OK\r\n"
+    "content-type: application/json\r\n"
+    "content-length: 128\r\n"
+    "x-request-id: 5b7c1e2a-94f3-4d1c-8b6e-2f0a9c3d7e11\r\n"
+    "x-upstream-latency-ms: 3\r\n"
+    "connection: keep-alive\r\n"
+    "\r\n"sv,
+};
+
+template <class F>
+static double measure(std::size_t bytesPerRound, F &&f) {
+    std::size_t rounds = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    auto t1 = t0;
+    do {
+        for (int i = 0; i < 1000; ++i) {
+            f();
+        }
+        rounds += 1000;
+        t1 = std::chrono::steady_clock::now();
+    } while (t1 - t0 < 300ms);
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+    return bytesPerRound * rounds / secs / 1e6;
+}
+
+int main() {
+    std::vector<HTTPTokenizer const *> impls{&HTTPTokenizer::scalar()};
+#if CO_ASYNC_SIMD_X86
+    if (__builtin_cpu_supports("sse4.2")) {
+        impls.push_back(&HTTPTokenizer::sse42());
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        impls.push_back(&HTTPTokenizer::avx2());
+    }
+#endif
+    std::size_t total = 0;
+    for (auto msg: kCorpus) {
+        total += msg.size();
+    }
+    std::printf("corpus: %zu messages, %zu bytes, best=%s\n",
+                std::size(kCorpus), total, HTTPTokenizer::best().name);
+    std::printf("%-8s %14s %14s\n", "impl", "scan MB/s", "parse MB/s");
+    for (auto *impl: impls) {
+        volatile std::size_t sink = 0;
+        double scan = measure(total, [&] {
+            for (auto msg: kCorpus) {
+                std::size_t i = 0;
+                while (i < msg.size()) {
+                    i += impl->findCtl(msg.data() + i, msg.size() - i) + 1;
+                }
+                sink = sink + i;
+            }
+        });
+        std::vector<std::string> bufs(std::begin(kCorpus), std::end(kCorpus));
+        double parse = measure(total, [&] {
+            for (std::size_t k = 0; k < bufs.size(); ++k) {
+                HTTPParser<> parser(k == 0 ? HTTPParser<>::Request
+                                           : HTTPParser<>::Response,
+                                    *impl);
+                parser.parse(bufs[k]);
+                sink = sink + parser.numHeaders();
+            }
+        });
+        std::printf("%-8s %14.1f %14.1f\n", impl->name, scan, parse);
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <co_async/task.hpp>
+#include <co_async/noop_loop.hpp>
+#include <co_async/when_all.hpp>
+#include <co_async/when_any.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+using namespace std::literals;
+using namespace co_async;
+
+// 测量 when_all / when_any 扇出的开销：子任务同步完成，
+// 耗时与分配次数中除子任务自身的协程帧外都来自组合器
+
+static std::size_t gAllocs = 0;
+
+void *operator new(std::size_t size) {
+    ++gAllocs;
+    if (void *p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+static volatile int sink = 0;
+
+static Task<int> leaf(int x) {
+    co_return x;
+}
+
+static Task<> allFixed(std::size_t rounds) {
+    for (std::size_t i = 0; i < rounds; ++i) {
+        auto [a, b, c] = co_await when_all(leaf(1), leaf(2), leaf(3));
+        sink = sink + a + b + c;
+    }
+}
+
+static Task<> anyFixed(std::size_t rounds) {
+    for (std::size_t i = 0; i < rounds; ++i) {
+        auto v = co_await when_any(leaf(1), leaf(2), leaf(3));
+        sink = sink + int(v.index());
+    }
+}
+
+static Task<> allVector(std::size_t rounds, std::size_t n) {
+    std::vector<Task<int>> tasks;
+    for (std::size_t i = 0; i < rounds; ++i) {
+        tasks.clear();
+        for (std::size_t j = 0; j < n; ++j) {
+            tasks.push_back(leaf(int(j)));
+        }
+        auto res = co_await when_all(tasks);
+        sink = sink + res.back();
+    }
+}
+
+static Task<> anyVector(std::size_t rounds, std::size_t n) {
+    std::vector<Task<int>> tasks;
+    for (std::size_t i = 0; i < rounds; ++i) {
+        tasks.clear();
+        for (std::size_t j = 0; j < n; ++j) {
+            tasks.push_back(leaf(int(j)));
+        }
+        sink = sink + co_await when_any(tasks);
+    }
+}
+
+template <class F>
+static void run(char const *name, std::size_t n, F &&f) {
+    NoopLoop loop;
+    std::size_t rounds = 0;
+    std::size_t allocs = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    auto t1 = t0;
+    do {
+        std::size_t before = gAllocs;
+        run_task(loop, f(10000));
+        allocs += gAllocs - before - 1;
+        rounds += 10000;
+        t1 = std::chrono::steady_clock::now();
+    } while (t1 - t0 < 300ms);
+    std::printf("%-12s %6zu %12.1f %12.2f\n", name, n,
+                std::chrono::duration<double, std::nano>(t1 - t0).count() /
+                    rounds,
+                double(allocs) / rounds);
+}
+
+int main() {
+    std::printf("%-12s %6s %12s %12s\n", "combinator", "tasks", "ns/op",
+                "allocs/op");
+    run("when_all", 3, [](std::size_t r) { return allFixed(r); });
+    run("when_any", 3, [](std::size_t r) { return anyFixed(r); });
+    for (std::size_t n: {3, 5, 10, 32}) {
+        run("when_all vec", n, [n](std::size_t r) { return allVector(r, n); });
+        run("when_any vec", n, [n](std::size_t r) { return anyVector(r, n); });
+    }
+    return 0;
+}
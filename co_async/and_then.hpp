@@ -1,35 +1,309 @@
 #pragma once
 
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <type_traits>
 #include <utility>
-#include <co_async/task.hpp>
 #include <co_async/concepts.hpp>
-#include <co_async/make_awaitable.hpp>
+#include <co_async/stop_token.hpp>
+#include <co_async/when_child.hpp>
 
 namespace co_async {
 
-template <Awaitable A, std::invocable<typename AwaitableTraits<A>::RetType> F>
-    requires(!std::same_as<void, typename AwaitableTraits<A>::RetType>)
-Task<typename AwaitableTraits<
-    std::invoke_result_t<F, typename AwaitableTraits<A>::RetType>>::Type>
-and_then(A &&a, F &&f) {
-    co_return co_await make_awaitable(
-        std::forward<F>(f)(co_await std::forward<A>(a)));
-}
+// and_then 的第二步：F 以第一步的结果调用 (第一步无结果时无参调用)，
+// 或者 F 本身就是可等待对象，等第一步完成后再等它
+template <class F, class R>
+struct AndThenNext {
+    static constexpr bool kCall = false;
+    using Type = std::remove_reference_t<F> &;
+};
 
-template <Awaitable A, std::invocable<> F>
-    requires(std::same_as<void, typename AwaitableTraits<A>::RetType>)
-Task<typename AwaitableTraits<std::invoke_result_t<F>>::Type> and_then(A &&a,
-                                                                       F &&f) {
-    co_await std::forward<A>(a);
-    co_return co_await make_awaitable(std::forward<F>(f)());
-}
+template <class F, class R>
+    requires std::invocable<F, R>
+struct AndThenNext<F, R> {
+    static constexpr bool kCall = true;
+    using Type = std::invoke_result_t<F, R>;
+};
+
+template <class F>
+    requires std::invocable<F>
+struct AndThenNext<F, void> {
+    static constexpr bool kCall = true;
+    using Type = std::invoke_result_t<F>;
+};
+
+// 延续链的表达式模板：and_then 不再是协程，只把两步保存下来，
+// 嵌套的 and_then 在编译期组合成一个 awaiter，全部存放在等待者的帧里。
+// 第一步经完成回调回到 awaiter，调用 F 后再等第二步；
+// F 返回普通值时直接作为结果，不需要为它再创建协程
+template <class A, class F>
+struct [[nodiscard]] AndThen {
+    using First = std::remove_reference_t<A>;
+    using FirstRet = typename AwaitableTraits<First>::RetType;
+    using Next = AndThenNext<F, FirstRet>;
+    using Second = typename Next::Type;
+    using RetType = typename AwaitableTraits<Second>::Type;
+
+    struct Awaiter : private CompletionHook {
+        using FirstAwaiter = WhenAwaiterOf<First>;
+        using SecondObject = std::remove_reference_t<Second>;
+        static constexpr bool kSecondAwaitable = Awaitable<SecondObject>;
+
+        bool await_ready() {
+            auto &first = FirstAwaiter::unwrap(
+                mFirst.emplace(FirstAwaiter::get(mAndThen->mFirst)));
+            return first.await_ready() && advance();
+        }
+
+        template <class P>
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<P> coroutine) {
+            inherit_stop_token(stopTokenOf(coroutine));
+            mPrevious = coroutine;
+            return start();
+        }
+
+        // 作为组合器的子任务时不需要等待者的协程帧，结束时调用 hook；
+        // 第二步直接向 hook 报告完成
+        std::coroutine_handle<> await_hook(CompletionHook *hook) {
+            mHook = hook;
+            return start();
+        }
+
+        RetType await_resume() {
+            mPending = false;
+            if (mException) [[unlikely]] {
+                std::rethrow_exception(std::exchange(mException, nullptr));
+            }
+            if constexpr (kSecondAwaitable) {
+                return secondAwaiter().await_resume();
+            } else if constexpr (!std::is_void_v<Second>) {
+                return std::forward<Second>(second());
+            }
+        }
+
+        // 被 when_any 等放弃时，正在等待的那一步不再跳回这里
+        void detach() noexcept {
+            if (!mPending) {
+                return;
+            }
+            mPending = false;
+            if (!mSecondStarted) {
+                auto &first = FirstAwaiter::unwrap(*mFirst);
+                if constexpr (requires { first.detach(); }) {
+                    first.detach();
+                }
+            } else if constexpr (kSecondAwaitable) {
+                auto &awaiter = secondAwaiter();
+                if constexpr (requires { awaiter.detach(); }) {
+                    awaiter.detach();
+                }
+            }
+        }
+
+        // 两步都沿用等待者的 StopToken
+        void inherit_stop_token(StopToken token) noexcept {
+            if (!mStopToken.stop_possible()) {
+                mStopToken = token;
+            }
+        }
+
+        explicit Awaiter(AndThen &andThen) noexcept
+            : CompletionHook{&Awaiter::onFirstDone},
+              mAndThen(&andThen) {}
+
+        // 只能在开始等待前移动，如作为参数传给 when_any
+        Awaiter(Awaiter &&that) noexcept : Awaiter(*that.mAndThen) {}
+
+        ~Awaiter() {
+            detach();
+        }
+
+    private:
+        // 返回接着恢复的协程
+        std::coroutine_handle<> start() {
+            mPending = true;
+            if (!mSecondStarted) {
+                if (auto next = suspendFirst()) {
+                    return next;
+                }
+                // 第一步同步完成，接着在这里开始第二步
+                if (advance()) {
+                    return done();
+                }
+            }
+            if constexpr (kSecondAwaitable) {
+                return suspendSecond();
+            } else {
+                __builtin_unreachable();
+            }
+        }
+
+        // 两步都已完成，回到等待者或报告给 hook
+        std::coroutine_handle<> done() noexcept {
+            if (mHook) {
+                return mHook->mCallback(*mHook);
+            }
+            return mPrevious;
+        }
+
+        using SecondStorage = typename WhenResult<Second>::Type;
+        // 第二步不是可等待对象时不需要 awaiter，占位用 NonVoidHelper
+        using SecondAwaiter =
+            std::conditional_t<kSecondAwaitable, WhenAwaiterOf<SecondObject>,
+                               WhenResult<void>>;
+
+        // 返回 coroutine 表示 awaiter 已经同步完成，应当继续执行
+        template <class Aw>
+        std::coroutine_handle<> suspendOn(Aw &awaiter,
+                                          std::coroutine_handle<> coroutine) {
+            inheritStopToken(awaiter, mStopToken);
+            using Suspend = decltype(awaiter.await_suspend(coroutine));
+            if constexpr (std::is_void_v<Suspend>) {
+                awaiter.await_suspend(coroutine);
+                return std::noop_coroutine();
+            } else if constexpr (std::is_same_v<Suspend, bool>) {
+                if (!awaiter.await_suspend(coroutine)) {
+                    return coroutine;
+                }
+                return std::noop_coroutine();
+            } else {
+                return awaiter.await_suspend(coroutine);
+            }
+        }
+
+        auto &second() noexcept {
+            if constexpr (Next::kCall) {
+                std::unwrap_reference_t<SecondStorage> &value = *mSecond;
+                return value;
+            } else {
+                return mAndThen->mNext;
+            }
+        }
+
+        auto &secondAwaiter() noexcept {
+            return SecondAwaiter::unwrap(*mSecondAwaiter);
+        }
+
+        // 第一步完成后取出结果、调用 F，返回第二步是否也已经完成；
+        // 异常留到 await_resume 时抛出
+        bool advance() {
+            try {
+                auto &first = FirstAwaiter::unwrap(*mFirst);
+                if constexpr (!Next::kCall) {
+                    first.await_resume();
+                } else if constexpr (std::is_void_v<FirstRet>) {
+                    first.await_resume();
+                    emplaceSecond(std::forward<F>(mAndThen->mNext));
+                } else {
+                    emplaceSecond(std::forward<F>(mAndThen->mNext),
+                                  first.await_resume());
+                }
+                mSecondStarted = true;
+                if constexpr (kSecondAwaitable) {
+                    return SecondAwaiter::unwrap(
+                               mSecondAwaiter.emplace(
+                                   SecondAwaiter::get(second())))
+                        .await_ready();
+                }
+                return true;
+            } catch (...) {
+                mException = std::current_exception();
+                return true;
+            }
+        }
+
+        template <class... Args>
+        void emplaceSecond(F &&func, Args &&...args) {
+            if constexpr (std::is_void_v<Second>) {
+                std::invoke(std::forward<F>(func), std::forward<Args>(args)...);
+                mSecond.emplace();
+            } else {
+                mSecond.emplace(std::invoke(std::forward<F>(func),
+                                            std::forward<Args>(args)...));
+            }
+        }
+
+        // 开始等待第一步，返回接着恢复的协程；第一步同步完成时返回空
+        std::coroutine_handle<> suspendFirst() {
+            auto &first = FirstAwaiter::unwrap(*mFirst);
+            using Aw = std::remove_reference_t<decltype(first)>;
+            if constexpr (HookAwaiter<Aw>) {
+                inheritStopToken(first, mStopToken);
+                return first.await_hook(this);
+            } else {
+                mTrampoline = WhenTrampoline::make(*this);
+                auto next = suspendOn(first, mTrampoline.handle());
+                if (next == mTrampoline.handle()) {
+                    return nullptr;
+                }
+                return next;
+            }
+        }
+
+        std::coroutine_handle<> suspendSecond() {
+            auto &second = secondAwaiter();
+            if (!mHook) {
+                return suspendOn(second, mPrevious);
+            }
+            using Aw = std::remove_reference_t<decltype(second)>;
+            if constexpr (HookAwaiter<Aw>) {
+                inheritStopToken(second, mStopToken);
+                return second.await_hook(mHook);
+            } else {
+                // 同步完成时返回的跳板被恢复后即调用 hook
+                mSecondTrampoline = WhenTrampoline::make(*mHook);
+                return suspendOn(second, mSecondTrampoline.handle());
+            }
+        }
+
+        // 第一步结束时经完成回调进入，返回值即接着恢复的协程；
+        // 跳转到等待者后本对象可能已随其帧销毁，返回前不能再访问
+        static std::coroutine_handle<>
+        onFirstDone(CompletionHook &hook) noexcept {
+            auto &self = static_cast<Awaiter &>(hook);
+            if (!self.advance()) {
+                if constexpr (kSecondAwaitable) {
+                    try {
+                        return self.suspendSecond();
+                    } catch (...) {
+                        self.mException = std::current_exception();
+                    }
+                }
+            }
+            return self.done();
+        }
+
+        AndThen *mAndThen;
+        std::coroutine_handle<> mPrevious{};
+        CompletionHook *mHook = nullptr;
+        std::exception_ptr mException{};
+        StopToken mStopToken{};
+        bool mPending = false;
+        bool mSecondStarted = false;
+        std::optional<typename FirstAwaiter::Type> mFirst;
+        std::optional<SecondStorage> mSecond;
+        std::optional<typename SecondAwaiter::Type> mSecondAwaiter;
+        // 第一步与第二步各自的跳板，只用于不支持完成回调的 awaiter
+        WhenTrampoline mTrampoline;
+        WhenTrampoline mSecondTrampoline;
+    };
+
+    Awaiter operator co_await() noexcept {
+        return Awaiter(*this);
+    }
+
+    A mFirst;
+    F mNext;
+};
 
-template <Awaitable A, Awaitable F>
-    requires(!std::invocable<F> &&
-             !std::invocable<F, typename AwaitableTraits<A>::RetType>)
-Task<typename AwaitableTraits<F>::RetType> and_then(A &&a, F &&f) {
-    co_await std::forward<A>(a);
-    co_return co_await std::forward<F>(f);
+template <Awaitable A, class F>
+    requires(AndThenNext<F, typename AwaitableTraits<A>::RetType>::kCall ||
+             Awaitable<F>)
+AndThen<A, F> and_then(A &&a, F &&f) {
+    return AndThen<A, F>{std::forward<A>(a), std::forward<F>(f)};
 }
 
 } // namespace co_async
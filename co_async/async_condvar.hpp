@@ -0,0 +1,109 @@
+#pragma once
+
+#include <coroutine>
+#include <mutex>
+#include <co_async/async_mutex.hpp>
+#include <co_async/wait_queue.hpp>
+
+namespace co_async {
+
+// 异步条件变量，与 BasicAsyncMutex 配合使用。通知时等待者不立即恢复，
+// 而是转入互斥锁的等待队列，拿到锁后才恢复，避免醒来后又阻塞在锁上。
+// 与 std::condition_variable 一样需要在循环中检查条件：
+//     while (!ready) co_await cv.wait(mutex);
+template <class Lock>
+struct BasicAsyncCondVar {
+    using Mutex = BasicAsyncMutex<Lock>;
+
+    BasicAsyncCondVar() = default;
+    BasicAsyncCondVar(BasicAsyncCondVar &&) = delete;
+
+    // 调用前必须持有 mutex，恢复时仍然持有
+    struct [[nodiscard]] WaitAwaiter : WaitQueueNode {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            this->mCoroutine = coroutine;
+            Mutex &mutex = mMutex;
+            {
+                std::lock_guard guard(mCondVar.mLock);
+                mCondVar.mQueue.pushBack(this);
+            }
+            // 释放锁可能同步地通知并恢复本协程，此后不能再访问本对象
+            mutex.unlock();
+        }
+
+        void await_resume() const noexcept {}
+
+        WaitAwaiter(BasicAsyncCondVar &condVar, Mutex &mutex) noexcept
+            : mCondVar(condVar),
+              mMutex(mutex) {}
+
+        WaitAwaiter(WaitAwaiter &&) = delete;
+
+        // 已拿到锁但尚未恢复就被销毁时释放锁
+        ~WaitAwaiter() {
+            if (this->mReady) {
+                this->unlink();
+                mMutex.unlock();
+            } else if (this->mPrev) {
+                if (mMorphed) {
+                    std::lock_guard guard(mMutex.mLock);
+                    this->unlink();
+                } else {
+                    std::lock_guard guard(mCondVar.mLock);
+                    this->unlink();
+                }
+            }
+        }
+
+        BasicAsyncCondVar &mCondVar;
+        Mutex &mMutex;
+        bool mMorphed = false;
+    };
+
+    WaitAwaiter wait(Mutex &mutex) noexcept {
+        return WaitAwaiter(*this, mutex);
+    }
+
+    void notify_one() noexcept {
+        WaitQueueNode *node;
+        {
+            std::lock_guard guard(mLock);
+            node = mQueue.popFront();
+        }
+        if (node) {
+            wake(static_cast<WaitAwaiter *>(node));
+        }
+    }
+
+    // 只唤醒调用时已在等待的协程，醒来后再次等待的不会被本次通知唤醒
+    void notify_all() noexcept {
+        WaitQueue woken;
+        {
+            std::lock_guard guard(mLock);
+            woken.append(mQueue);
+        }
+        while (WaitQueueNode *node = woken.popFront()) {
+            wake(static_cast<WaitAwaiter *>(node));
+        }
+    }
+
+private:
+    static void wake(WaitAwaiter *waiter) noexcept {
+        waiter->mMorphed = true;
+        if (waiter->mMutex.lockOrEnqueue(waiter)) {
+            ReadyQueue::current().wake(waiter);
+        }
+    }
+
+    Lock mLock;
+    WaitQueue mQueue;
+};
+
+// 与 AsyncMutex 相同，只在一个事件循环内使用
+using AsyncCondVar = BasicAsyncCondVar<NullLock>;
+
+} // namespace co_async
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <coroutine>
+#include <mutex>
+#include <co_async/wait_queue.hpp>
+
+namespace co_async {
+
+// 手动复位的事件：set 唤醒全部等待者，之后的 wait 立即返回，直到 reset
+template <class Lock>
+struct BasicAsyncEvent {
+    explicit BasicAsyncEvent(bool set = false) noexcept : mSet(set) {}
+
+    BasicAsyncEvent(BasicAsyncEvent &&) = delete;
+
+    struct [[nodiscard]] WaitAwaiter : WaitQueueNode {
+        bool await_ready() noexcept {
+            return mEvent.is_set();
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            this->mCoroutine = coroutine;
+            std::lock_guard guard(mEvent.mLock);
+            if (mEvent.mSet) {
+                return false;
+            }
+            mEvent.mQueue.pushBack(this);
+            return true;
+        }
+
+        void await_resume() const noexcept {}
+
+        explicit WaitAwaiter(BasicAsyncEvent &event) noexcept
+            : mEvent(event) {}
+
+        WaitAwaiter(WaitAwaiter &&) = delete;
+
+        ~WaitAwaiter() {
+            if (this->mReady) {
+                this->unlink();
+            } else if (this->mPrev) {
+                std::lock_guard guard(mEvent.mLock);
+                this->unlink();
+            }
+        }
+
+        BasicAsyncEvent &mEvent;
+    };
+
+    WaitAwaiter wait() noexcept {
+        return WaitAwaiter(*this);
+    }
+
+    // 先取出全部等待者再逐个唤醒，被恢复者 reset 后新来的等待者不受影响
+    void set() noexcept {
+        WaitQueue woken;
+        {
+            std::lock_guard guard(mLock);
+            if (mSet) {
+                return;
+            }
+            mSet = true;
+            woken.append(mQueue);
+        }
+        while (WaitQueueNode *node = woken.popFront()) {
+            ReadyQueue::current().wake(node);
+        }
+    }
+
+    void reset() noexcept {
+        std::lock_guard guard(mLock);
+        mSet = false;
+    }
+
+    bool is_set() noexcept {
+        std::lock_guard guard(mLock);
+        return mSet;
+    }
+
+private:
+    Lock mLock;
+    bool mSet;
+    WaitQueue mQueue;
+};
+
+// 与 AsyncMutex 相同，只在一个事件循环内使用
+using AsyncEvent = BasicAsyncEvent<NullLock>;
+
+} // namespace co_async
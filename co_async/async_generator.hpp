@@ -0,0 +1,182 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <co_async/concepts.hpp>
+#include <co_async/previous_awaiter.hpp>
+#include <co_async/stop_token.hpp>
+#include <co_async/task.hpp>
+
+namespace co_async {
+
+template <class T>
+struct AsyncGeneratorPromise {
+    auto initial_suspend() noexcept {
+        return std::suspend_always();
+    }
+
+    auto final_suspend() noexcept {
+        return PreviousAwaiter(mPrevious);
+    }
+
+    void unhandled_exception() noexcept {
+        mException = std::current_exception();
+    }
+
+    // 产出的值留在生成器的帧里直到下次恢复，消费者直接从这里取走，
+    // 不经过任何中间缓冲
+    auto yield_value(T &value) noexcept {
+        mValue = std::addressof(value);
+        return PreviousAwaiter(mPrevious);
+    }
+
+    auto yield_value(T &&value) noexcept {
+        mValue = std::addressof(value);
+        return PreviousAwaiter(mPrevious);
+    }
+
+    // const 左值只能复制一份，副本存放在挂起期间存活的 awaiter 里
+    auto yield_value(T const &value) {
+        struct CopyAwaiter : PreviousAwaiter {
+            std::coroutine_handle<>
+            await_suspend(std::coroutine_handle<> coroutine) noexcept {
+                mPromise.mValue = std::addressof(mCopy);
+                return mPrevious;
+            }
+
+            AsyncGeneratorPromise &mPromise;
+            T mCopy;
+        };
+
+        return CopyAwaiter{{mPrevious}, *this, value};
+    }
+
+    void return_void() noexcept {}
+
+    auto get_return_object() {
+        return std::coroutine_handle<AsyncGeneratorPromise>::from_promise(
+            *this);
+    }
+
+    std::coroutine_handle<> mPrevious{};
+    T *mValue{};
+    std::exception_ptr mException{};
+    StopToken mStopToken{};
+
+    AsyncGeneratorPromise &operator=(AsyncGeneratorPromise &&) = delete;
+};
+
+// 异步生成器：生成器内既可以 co_await 事件循环上的操作，也可以 co_yield 值。
+// 每次 co_await 生成器都恢复它直到下一个 co_yield，再经对称转移切回消费者，
+// 两边直接交接，没有队列；结束后返回 nullopt，生成器内的异常在此重新抛出
+template <class T>
+struct [[nodiscard]] AsyncGenerator {
+    static_assert(!std::is_reference_v<T>);
+
+    using promise_type = AsyncGeneratorPromise<T>;
+
+    AsyncGenerator(std::coroutine_handle<promise_type> coroutine =
+                       nullptr) noexcept
+        : mCoroutine(coroutine) {}
+
+    AsyncGenerator(AsyncGenerator &&that) noexcept
+        : mCoroutine(std::exchange(that.mCoroutine, nullptr)) {}
+
+    AsyncGenerator &operator=(AsyncGenerator &&that) noexcept {
+        std::swap(mCoroutine, that.mCoroutine);
+        return *this;
+    }
+
+    ~AsyncGenerator() {
+        if (mCoroutine)
+            mCoroutine.destroy();
+    }
+
+    // 返回指向生成器帧中的值的指针，结束时为空；值在下次恢复前有效
+    struct NextAwaiter {
+        bool await_ready() const noexcept {
+            return !mCoroutine || mCoroutine.done();
+        }
+
+        template <class P>
+        std::coroutine_handle<promise_type>
+        await_suspend(std::coroutine_handle<P> coroutine) const noexcept {
+            mCoroutine.promise().mPrevious = coroutine;
+            inherit_stop_token(stopTokenOf(coroutine));
+            return mCoroutine;
+        }
+
+        T *await_resume() const {
+            if (!mCoroutine) [[unlikely]] {
+                return nullptr;
+            }
+            promise_type &promise = mCoroutine.promise();
+            if (mCoroutine.done()) {
+                if (promise.mException) [[unlikely]] {
+                    std::rethrow_exception(
+                        std::exchange(promise.mException, nullptr));
+                }
+                return nullptr;
+            }
+            return promise.mValue;
+        }
+
+        // 等待者被 when_any 等放弃时，生成器产出下一个值后不恢复任何协程，
+        // 这个值随之丢弃
+        void detach() const noexcept {
+            mCoroutine.promise().mPrevious = std::noop_coroutine();
+        }
+
+        // 生成器内的 co_await 沿用消费者的 StopToken，除非已经指定
+        void inherit_stop_token(StopToken token) const noexcept {
+            if (!mCoroutine) [[unlikely]] {
+                return;
+            }
+            promise_type &promise = mCoroutine.promise();
+            if (!promise.mStopToken.stop_possible()) {
+                promise.mStopToken = token;
+            }
+        }
+
+        std::coroutine_handle<promise_type> mCoroutine;
+    };
+
+    struct Awaiter : NextAwaiter {
+        std::optional<T> await_resume() const {
+            if (T *value = NextAwaiter::await_resume()) {
+                return std::optional<T>(std::in_place, std::move(*value));
+            }
+            return std::nullopt;
+        }
+    };
+
+    auto operator co_await() const noexcept {
+        return Awaiter{{mCoroutine}};
+    }
+
+    auto next() const noexcept {
+        return NextAwaiter(mCoroutine);
+    }
+
+private:
+    std::coroutine_handle<promise_type> mCoroutine;
+};
+
+// 相当于 for co_await：依次以生成器产出的值的引用调用 f，不移动也不复制；
+// f 返回 Task 等可等待对象时，等它完成后才取下一个值
+template <class T, class F>
+Task<> async_for_each(AsyncGenerator<T> gen, F f) {
+    while (T *value = co_await gen.next()) {
+        if constexpr (Awaitable<std::invoke_result_t<F &, T &>>) {
+            co_await f(*value);
+        } else {
+            f(*value);
+        }
+    }
+}
+
+} // namespace co_async
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <coroutine>
+#include <mutex>
+#include <utility>
+#include <co_async/wait_queue.hpp>
+
+namespace co_async {
+
+template <class Lock>
+struct BasicAsyncCondVar;
+
+// 异步互斥锁：unlock 时若有等待者，锁直接交给队首的等待者而不释放，
+// 先来先得，后来者不能插队；等待者经 ReadyQueue 在 unlock 的调用者
+// 挂起后恢复，而不是在 unlock 中嵌套恢复
+template <class Lock>
+struct BasicAsyncMutex {
+    BasicAsyncMutex() = default;
+    BasicAsyncMutex(BasicAsyncMutex &&) = delete;
+
+    struct [[nodiscard]] LockAwaiter : WaitQueueNode {
+        bool await_ready() noexcept {
+            return mMutex.try_lock();
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            this->mCoroutine = coroutine;
+            return !mMutex.lockOrEnqueue(this);
+        }
+
+        void await_resume() const noexcept {}
+
+        explicit LockAwaiter(BasicAsyncMutex &mutex) noexcept
+            : mMutex(mutex) {}
+
+        LockAwaiter(LockAwaiter &&) = delete;
+
+        // 等待中的协程被销毁时退出队列；已被交予锁但尚未恢复的，
+        // 把锁转交给下一个等待者
+        ~LockAwaiter() {
+            if (this->mReady) {
+                this->unlink();
+                mMutex.unlock();
+            } else if (this->mPrev) {
+                std::lock_guard guard(mMutex.mLock);
+                this->unlink();
+            }
+        }
+
+        BasicAsyncMutex &mMutex;
+    };
+
+    // 离开作用域时自动 unlock
+    struct [[nodiscard]] Guard {
+        explicit Guard(BasicAsyncMutex &mutex) noexcept : mMutex(&mutex) {}
+
+        Guard(Guard &&that) noexcept
+            : mMutex(std::exchange(that.mMutex, nullptr)) {}
+
+        Guard &operator=(Guard &&) = delete;
+
+        ~Guard() {
+            unlock();
+        }
+
+        void unlock() noexcept {
+            if (mMutex) {
+                std::exchange(mMutex, nullptr)->unlock();
+            }
+        }
+
+    private:
+        BasicAsyncMutex *mMutex;
+    };
+
+    struct [[nodiscard]] ScopedLockAwaiter : LockAwaiter {
+        using LockAwaiter::LockAwaiter;
+
+        Guard await_resume() const noexcept {
+            return Guard(this->mMutex);
+        }
+    };
+
+    LockAwaiter lock() noexcept {
+        return LockAwaiter(*this);
+    }
+
+    ScopedLockAwaiter scoped_lock() noexcept {
+        return ScopedLockAwaiter(*this);
+    }
+
+    bool try_lock() noexcept {
+        std::lock_guard guard(mLock);
+        return !std::exchange(mLocked, true);
+    }
+
+    void unlock() noexcept {
+        WaitQueueNode *node;
+        {
+            std::lock_guard guard(mLock);
+            node = mQueue.popFront();
+            if (!node) {
+                mLocked = false;
+                return;
+            }
+        }
+        ReadyQueue::current().wake(node);
+    }
+
+private:
+    friend struct BasicAsyncCondVar<Lock>;
+
+    // 锁空闲时直接占有并返回 true，否则把 node 排入队尾
+    bool lockOrEnqueue(WaitQueueNode *node) noexcept {
+        std::lock_guard guard(mLock);
+        if (!mLocked) {
+            mLocked = true;
+            return true;
+        }
+        mQueue.pushBack(node);
+        return false;
+    }
+
+    Lock mLock;
+    bool mLocked = false;
+    WaitQueue mQueue;
+};
+
+// 只在一个事件循环内使用，不含原子操作。被唤醒的协程总是在唤醒者的
+// 线程上恢复，即使换成 SpinLock 也不能用来同步分属不同线程事件循环的
+// 协程，跨线程传递数据请用 SpscChannel
+using AsyncMutex = BasicAsyncMutex<NullLock>;
+
+} // namespace co_async
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <mutex>
+#include <co_async/wait_queue.hpp>
+
+namespace co_async {
+
+// 计数信号量：release 时名额直接交给队首的等待者，先来先得
+template <class Lock>
+struct BasicAsyncSemaphore {
+    explicit BasicAsyncSemaphore(std::size_t initial = 0) noexcept
+        : mCount(initial) {}
+
+    BasicAsyncSemaphore(BasicAsyncSemaphore &&) = delete;
+
+    struct [[nodiscard]] AcquireAwaiter : WaitQueueNode {
+        bool await_ready() noexcept {
+            return mSemaphore.try_acquire();
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            this->mCoroutine = coroutine;
+            return !mSemaphore.acquireOrEnqueue(this);
+        }
+
+        void await_resume() const noexcept {}
+
+        explicit AcquireAwaiter(BasicAsyncSemaphore &semaphore) noexcept
+            : mSemaphore(semaphore) {}
+
+        AcquireAwaiter(AcquireAwaiter &&) = delete;
+
+        // 已分得名额但尚未恢复就被销毁时归还名额
+        ~AcquireAwaiter() {
+            if (this->mReady) {
+                this->unlink();
+                mSemaphore.release();
+            } else if (this->mPrev) {
+                std::lock_guard guard(mSemaphore.mLock);
+                this->unlink();
+            }
+        }
+
+        BasicAsyncSemaphore &mSemaphore;
+    };
+
+    AcquireAwaiter acquire() noexcept {
+        return AcquireAwaiter(*this);
+    }
+
+    bool try_acquire() noexcept {
+        std::lock_guard guard(mLock);
+        if (mCount == 0) {
+            return false;
+        }
+        --mCount;
+        return true;
+    }
+
+    void release(std::size_t n = 1) noexcept {
+        while (n != 0) {
+            WaitQueueNode *node;
+            {
+                std::lock_guard guard(mLock);
+                node = mQueue.popFront();
+                if (!node) {
+                    mCount += n;
+                    return;
+                }
+            }
+            --n;
+            ReadyQueue::current().wake(node);
+        }
+    }
+
+    std::size_t available() noexcept {
+        std::lock_guard guard(mLock);
+        return mCount;
+    }
+
+private:
+    bool acquireOrEnqueue(WaitQueueNode *node) noexcept {
+        std::lock_guard guard(mLock);
+        if (mCount != 0) {
+            --mCount;
+            return true;
+        }
+        mQueue.pushBack(node);
+        return false;
+    }
+
+    Lock mLock;
+    std::size_t mCount;
+    WaitQueue mQueue;
+};
+
+// 与 AsyncMutex 相同，只在一个事件循环内使用
+using AsyncSemaphore = BasicAsyncSemaphore<NullLock>;
+
+} // namespace co_async
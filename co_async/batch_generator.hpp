@@ -0,0 +1,225 @@
+#pragma once
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <co_async/previous_awaiter.hpp>
+#include <co_async/stop_token.hpp>
+
+namespace co_async {
+
+template <class T, std::size_t N>
+struct BatchGeneratorPromise {
+    // 缓冲区未满时 co_yield 不挂起，满了才切回消费者
+    struct YieldAwaiter {
+        bool await_ready() const noexcept {
+            return mReady;
+        }
+
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<BatchGeneratorPromise> coroutine)
+            const noexcept {
+            return coroutine.promise().mPrevious;
+        }
+
+        void await_resume() const noexcept {}
+
+        bool mReady;
+    };
+
+    // 整块产出时不复制，消费者直接读这块内存；缓冲区中还有元素时，
+    // 先交出缓冲区，这一块留待消费者取完缓冲区后再取
+    struct SpanYieldAwaiter {
+        bool await_ready() const noexcept {
+            return mValues.empty();
+        }
+
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<BatchGeneratorPromise> coroutine)
+            const noexcept {
+            BatchGeneratorPromise &promise = coroutine.promise();
+            if (promise.mSize == 0) {
+                promise.mData = mValues.data();
+                promise.mSize = mValues.size();
+            } else {
+                promise.mPending = mValues;
+            }
+            return promise.mPrevious;
+        }
+
+        void await_resume() const noexcept {}
+
+        std::span<T> mValues;
+    };
+
+    auto initial_suspend() noexcept {
+        return std::suspend_always();
+    }
+
+    auto final_suspend() noexcept {
+        return PreviousAwaiter(mPrevious);
+    }
+
+    void unhandled_exception() noexcept {
+        mException = std::current_exception();
+    }
+
+    YieldAwaiter yield_value(T &&value) {
+        mBuffer[mSize++] = std::move(value);
+        return YieldAwaiter{mSize != N};
+    }
+
+    YieldAwaiter yield_value(T const &value) {
+        mBuffer[mSize++] = value;
+        return YieldAwaiter{mSize != N};
+    }
+
+    // 这块内存在生成器下次恢复前必须保持有效，消费者可以从中移走元素
+    SpanYieldAwaiter yield_value(std::span<T> values) noexcept {
+        return SpanYieldAwaiter{values};
+    }
+
+    void return_void() noexcept {}
+
+    auto get_return_object() {
+        return std::coroutine_handle<BatchGeneratorPromise>::from_promise(
+            *this);
+    }
+
+    std::coroutine_handle<> mPrevious{};
+    std::array<T, N> mBuffer;
+    // 消费者正在读的一批：mBuffer 或整块产出的内存
+    T *mData = mBuffer.data();
+    std::size_t mSize = 0;
+    std::size_t mRead = 0;
+    std::span<T> mPending;
+    std::exception_ptr mException{};
+    StopToken mStopToken{};
+
+    BatchGeneratorPromise &operator=(BatchGeneratorPromise &&) = delete;
+};
+
+// 成批产出的生成器：生成器内照常逐个 co_yield，值先存入 N 个元素的缓冲区，
+// 填满 (或生成器结束) 时才挂起一次，把挂起与恢复的开销分摊到 N 个元素上；
+// 已经成块的数据 (如读入的缓冲区) 可以 co_yield 一个 span，整块交出。
+// 消费者可以逐个取 (co_await gen 返回 optional，与 Generator 相同)，
+// 也可以整批取 (co_await gen.batch() 返回 span，结束时为空)
+template <class T, std::size_t N = 256>
+struct [[nodiscard]] BatchGenerator {
+    static_assert(N != 0 && std::is_default_constructible_v<T>);
+
+    using promise_type = BatchGeneratorPromise<T, N>;
+
+    BatchGenerator(std::coroutine_handle<promise_type> coroutine =
+                       nullptr) noexcept
+        : mCoroutine(coroutine) {}
+
+    BatchGenerator(BatchGenerator &&that) noexcept
+        : mCoroutine(std::exchange(that.mCoroutine, nullptr)) {}
+
+    BatchGenerator &operator=(BatchGenerator &&that) noexcept {
+        std::swap(mCoroutine, that.mCoroutine);
+        return *this;
+    }
+
+    ~BatchGenerator() {
+        if (mCoroutine)
+            mCoroutine.destroy();
+    }
+
+    // 缓冲区中还有未取走的元素时不必恢复生成器
+    struct BatchAwaiter {
+        bool await_ready() const noexcept {
+            if (!mCoroutine) [[unlikely]] {
+                return true;
+            }
+            promise_type &promise = mCoroutine.promise();
+            if (promise.mRead != promise.mSize) [[likely]] {
+                return true;
+            }
+            if (!promise.mPending.empty()) {
+                promise.mData = promise.mPending.data();
+                promise.mSize = promise.mPending.size();
+                promise.mRead = 0;
+                promise.mPending = {};
+                return true;
+            }
+            return mCoroutine.done();
+        }
+
+        template <class P>
+        std::coroutine_handle<promise_type>
+        await_suspend(std::coroutine_handle<P> coroutine) const noexcept {
+            promise_type &promise = mCoroutine.promise();
+            promise.mPrevious = coroutine;
+            inherit_stop_token(stopTokenOf(coroutine));
+            promise.mData = promise.mBuffer.data();
+            promise.mSize = promise.mRead = 0;
+            return mCoroutine;
+        }
+
+        // 返回剩余的整批元素，在下次恢复生成器前有效
+        std::span<T> await_resume() const {
+            if (!mCoroutine) [[unlikely]] {
+                return {};
+            }
+            promise_type &promise = mCoroutine.promise();
+            std::span<T> batch(promise.mData + promise.mRead,
+                               promise.mSize - promise.mRead);
+            promise.mRead = promise.mSize;
+            if (batch.empty() && promise.mException) [[unlikely]] {
+                std::rethrow_exception(
+                    std::exchange(promise.mException, nullptr));
+            }
+            return batch;
+        }
+
+        // 生成器内的 co_await 沿用消费者的 StopToken，除非已经指定
+        void inherit_stop_token(StopToken token) const noexcept {
+            if (!mCoroutine) [[unlikely]] {
+                return;
+            }
+            promise_type &promise = mCoroutine.promise();
+            if (!promise.mStopToken.stop_possible()) {
+                promise.mStopToken = token;
+            }
+        }
+
+        std::coroutine_handle<promise_type> mCoroutine;
+    };
+
+    // 逐个取出，只有缓冲区取空时才真正挂起
+    struct Awaiter : BatchAwaiter {
+        std::optional<T> await_resume() const {
+            if (this->mCoroutine) [[likely]] {
+                promise_type &promise = this->mCoroutine.promise();
+                if (promise.mRead != promise.mSize) [[likely]] {
+                    return std::move(promise.mData[promise.mRead++]);
+                }
+                if (promise.mException) [[unlikely]] {
+                    std::rethrow_exception(
+                        std::exchange(promise.mException, nullptr));
+                }
+            }
+            return std::nullopt;
+        }
+    };
+
+    auto operator co_await() const noexcept {
+        return Awaiter{{mCoroutine}};
+    }
+
+    auto batch() const noexcept {
+        return BatchAwaiter(mCoroutine);
+    }
+
+private:
+    std::coroutine_handle<promise_type> mCoroutine;
+};
+
+} // namespace co_async
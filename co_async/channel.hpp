@@ -0,0 +1,214 @@
+#pragma once
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <co_async/generator.hpp>
+#include <co_async/uninitialized.hpp>
+#include <co_async/wait_queue.hpp>
+
+namespace co_async {
+
+// 同一事件循环内协程间的有界通道，发送者与接收者都可以有任意多个。
+// 缓冲区是 N 个元素的环形数组，N 为 0 时发送者与接收者直接交接；
+// 缓冲区满时发送者挂起，空时接收者挂起，都按先来先得的顺序唤醒。
+// close 之后发送失败，接收者取完缓冲区中剩余的元素后得到 nullopt。
+// 被唤醒的一方经 ReadyQueue 在唤醒者挂起后恢复，不在对方的 awaiter 中嵌套执行。
+// send 与 recv 返回的 awaiter 可以交给 when_any，实现 select
+template <class T, std::size_t N = 0>
+struct Channel {
+    Channel() = default;
+    Channel(Channel &&) = delete;
+
+    ~Channel() {
+        while (mSize != 0) {
+            pop();
+        }
+    }
+
+    // 返回 false 表示通道已关闭，value 被丢弃
+    struct [[nodiscard]] SendAwaiter : WaitQueueNode {
+        bool await_ready() {
+            if (mChannel.mClosed) {
+                return true;
+            }
+            // 有接收者在等说明缓冲区为空，直接交给最早的接收者
+            if (auto *node = mChannel.mReceivers.popFront()) {
+                auto *receiver = static_cast<RecvAwaiter *>(node);
+                receiver->mValue.emplace(std::move(mValue));
+                mSent = true;
+                ReadyQueue::current().wake(receiver);
+                return true;
+            }
+            if (mChannel.mSize < N) {
+                mChannel.push(std::move(mValue));
+                mSent = true;
+                return true;
+            }
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            this->mCoroutine = coroutine;
+            mChannel.mSenders.pushBack(this);
+        }
+
+        bool await_resume() const noexcept {
+            return mSent;
+        }
+
+        SendAwaiter(Channel &channel, T &&value)
+            : mChannel(channel),
+              mValue(std::move(value)) {}
+
+        // 只能在开始等待前移动，如作为参数传给 when_any
+        SendAwaiter(SendAwaiter &&that)
+            : mChannel(that.mChannel),
+              mValue(std::move(that.mValue)) {}
+
+        ~SendAwaiter() {
+            this->unlink();
+        }
+
+        Channel &mChannel;
+        T mValue;
+        bool mSent = false;
+    };
+
+    // 返回 nullopt 表示通道已关闭且没有剩余的元素
+    struct [[nodiscard]] RecvAwaiter : WaitQueueNode {
+        bool await_ready() {
+            if (!mChannel.mReturned.empty()) [[unlikely]] {
+                mValue.emplace(std::move(mChannel.mReturned.front()));
+                mChannel.mReturned.erase(mChannel.mReturned.begin());
+                return true;
+            }
+            if (mChannel.mSize != 0) {
+                mValue.emplace(mChannel.pop());
+                // 腾出的位置让给最早等待的发送者
+                if (auto *node = mChannel.mSenders.popFront()) {
+                    auto *sender = static_cast<SendAwaiter *>(node);
+                    mChannel.push(std::move(sender->mValue));
+                    sender->mSent = true;
+                    ReadyQueue::current().wake(sender);
+                }
+                return true;
+            }
+            // 无缓冲的通道直接从发送者手中取
+            if (auto *node = mChannel.mSenders.popFront()) {
+                auto *sender = static_cast<SendAwaiter *>(node);
+                mValue.emplace(std::move(sender->mValue));
+                sender->mSent = true;
+                ReadyQueue::current().wake(sender);
+                return true;
+            }
+            return mChannel.mClosed;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            this->mCoroutine = coroutine;
+            mChannel.mReceivers.pushBack(this);
+        }
+
+        std::optional<T> await_resume() {
+            return std::move(mValue);
+        }
+
+        explicit RecvAwaiter(Channel &channel) noexcept : mChannel(channel) {}
+
+        RecvAwaiter(RecvAwaiter &&that) noexcept : mChannel(that.mChannel) {}
+
+        // 已分到元素却未及恢复就被销毁 (如在 when_any 中落选) 时把元素还回通道
+        ~RecvAwaiter() {
+            bool returned = this->mReady && mValue;
+            this->unlink();
+            if (returned) [[unlikely]] {
+                mChannel.putBack(std::move(*mValue));
+            }
+        }
+
+        Channel &mChannel;
+        std::optional<T> mValue;
+    };
+
+    SendAwaiter send(T value) {
+        return SendAwaiter(*this, std::move(value));
+    }
+
+    RecvAwaiter recv() noexcept {
+        return RecvAwaiter(*this);
+    }
+
+    // 唤醒所有等待者：接收者得到 nullopt，发送者得到 false
+    void close() {
+        if (mClosed) {
+            return;
+        }
+        mClosed = true;
+        WaitQueue woken;
+        woken.append(mReceivers);
+        woken.append(mSenders);
+        while (WaitQueueNode *node = woken.popFront()) {
+            ReadyQueue::current().wake(node);
+        }
+    }
+
+    bool closed() const noexcept {
+        return mClosed;
+    }
+
+    std::size_t size() const noexcept {
+        return mSize + mReturned.size();
+    }
+
+    // 把通道作为 Generator 的数据源，通道关闭并取完后结束
+    Generator<T> source() {
+        while (auto value = co_await recv()) {
+            co_yield std::move(*value);
+        }
+    }
+
+private:
+    // 还回的元素先于缓冲区中的元素被取走，有接收者在等时直接交给它
+    void putBack(T &&value) {
+        if (auto *node = mReceivers.popFront()) {
+            auto *receiver = static_cast<RecvAwaiter *>(node);
+            receiver->mValue.emplace(std::move(value));
+            ReadyQueue::current().wake(receiver);
+            return;
+        }
+        mReturned.push_back(std::move(value));
+    }
+
+    void push(T &&value) {
+        if constexpr (N != 0) {
+            mBuffer[(mHead + mSize) % N].putValue(std::move(value));
+            ++mSize;
+        }
+    }
+
+    T pop() {
+        if constexpr (N != 0) {
+            T value = mBuffer[mHead].moveValue();
+            mHead = (mHead + 1) % N;
+            --mSize;
+            return value;
+        } else {
+            __builtin_unreachable();
+        }
+    }
+
+    std::array<Uninitialized<T>, N> mBuffer;
+    std::size_t mHead = 0;
+    std::size_t mSize = 0;
+    bool mClosed = false;
+    WaitQueue mSenders;
+    WaitQueue mReceivers;
+    // 被取消的接收者还回的元素，通常为空
+    std::vector<T> mReturned;
+};
+
+} // namespace co_async
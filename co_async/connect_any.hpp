@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <co_async/task.hpp>
+#include <co_async/async_loop.hpp>
+#include <co_async/dns_resolver.hpp>
+#include <co_async/hedge.hpp>
+#include <co_async/socket.hpp>
+
+namespace co_async {
+
+// 按顺序错开发起连接 (RFC 8305)，返回最先成功的连接，其余尝试随之取消并关闭
+inline Task<AsyncFile>
+connect_any(AsyncLoop &loop, std::vector<SocketAddress> const &addrs,
+            std::chrono::system_clock::duration delay =
+                std::chrono::milliseconds(250)) {
+    if (addrs.empty()) [[unlikely]] {
+        throw std::invalid_argument("no address to connect");
+    }
+    co_return co_await hedge(
+        loop,
+        [&](std::size_t i) { return create_tcp_client(loop, addrs[i]); },
+        delay, addrs.size());
+}
+
+// 经 DnsResolver 异步解析 host 后交给 connect_any，解析期间不阻塞事件循环
+inline Task<AsyncFile>
+connect_host(AsyncLoop &loop, DnsResolver &resolver, std::string host,
+             int port,
+             std::chrono::system_clock::duration delay =
+                 std::chrono::milliseconds(250)) {
+    auto ips = co_await resolver.resolve(std::move(host));
+    co_return co_await connect_any(loop, socket_addresses(ips, port), delay);
+}
+
+} // namespace co_async
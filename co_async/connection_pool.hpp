@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/socket.h>
+#include <co_async/task.hpp>
+#include <co_async/epoll_loop.hpp>
+#include <co_async/timer_loop.hpp>
+#include <co_async/socket.hpp>
+#include <co_async/stream.hpp>
+#include <co_async/wait_queue.hpp>
+
+namespace co_async {
+
+struct ConnectionPool;
+
+struct ConnectionPoolHost {
+    struct IdleConnection {
+        FileStream mStream;
+        std::chrono::system_clock::time_point mExpireTime;
+    };
+
+    // 等待名额的协程，节点存放在等待者的协程帧里，帧销毁时自动摘除
+    struct Waiter : WaitQueueNode {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            mCoroutine = coroutine;
+            mHost.mWaiters.pushBack(this);
+        }
+
+        void await_resume() const noexcept {}
+
+        explicit Waiter(ConnectionPoolHost &host) noexcept : mHost(host) {}
+
+        Waiter(Waiter &&) = delete;
+
+        // 已被唤醒但尚未恢复就被销毁时，把这次唤醒转给下一个等待者
+        ~Waiter() {
+            unlink();
+            if (mReady) {
+                mHost.wakeOne();
+            }
+        }
+
+        ConnectionPoolHost &mHost;
+    };
+
+    ConnectionPoolHost() = default;
+    ConnectionPoolHost(ConnectionPoolHost &&) = delete;
+
+    // 经 ReadyQueue 恢复，归还连接的析构函数、清理循环中都不会被重入
+    void wakeOne() noexcept {
+        if (WaitQueueNode *node = mWaiters.popFront()) {
+            ReadyQueue::current().wake(node);
+        }
+    }
+
+    SocketAddress mAddr;
+    std::vector<IdleConnection> mIdle;
+    std::size_t mTotal = 0;
+    WaitQueue mWaiters;
+};
+
+struct [[nodiscard]] PooledConnection {
+    PooledConnection(FileStream &&stream, ConnectionPoolHost *host) noexcept
+        : mStream(std::move(stream)),
+          mHost(host) {}
+
+    PooledConnection(PooledConnection &&that) noexcept
+        : mStream(std::move(that.mStream)),
+          mHost(std::exchange(that.mHost, nullptr)) {}
+
+    PooledConnection &operator=(PooledConnection &&) = delete;
+
+    // 未归还给连接池的连接直接关闭，并把名额让给等待者
+    ~PooledConnection() {
+        if (mHost) {
+            --mHost->mTotal;
+            mHost->wakeOne();
+        }
+    }
+
+    FileStream &stream() noexcept {
+        return mStream;
+    }
+
+    FileStream *operator->() noexcept {
+        return &mStream;
+    }
+
+private:
+    friend struct ConnectionPool;
+
+    FileStream mStream;
+    ConnectionPoolHost *mHost;
+};
+
+struct ConnectionPool {
+    explicit ConnectionPool(EpollLoop &loop, TimerLoop &timer,
+                            std::size_t maxPerHost = 8,
+                            std::chrono::system_clock::duration idleTimeout =
+                                std::chrono::seconds(30))
+        : mLoop(loop),
+          mTimer(timer),
+          mMaxPerHost(maxPerHost),
+          mIdleTimeout(idleTimeout) {}
+
+    ConnectionPool &operator=(ConnectionPool &&) = delete;
+
+    // 优先复用最近归还的空闲连接，达到单主机上限时排队等待
+    Task<PooledConnection> acquire(SocketAddress const &addr) {
+        ConnectionPoolHost &host = hostOf(addr);
+        while (true) {
+            evictExpired(host, std::chrono::system_clock::now());
+            while (!host.mIdle.empty()) {
+                FileStream stream = std::move(host.mIdle.back().mStream);
+                host.mIdle.pop_back();
+                if (isAlive(stream.mFile)) [[likely]] {
+                    co_return PooledConnection(std::move(stream), &host);
+                }
+                --host.mTotal;
+            }
+            if (host.mTotal < mMaxPerHost) {
+                ++host.mTotal;
+                AsyncFile file;
+                try {
+                    file = co_await create_tcp_client(mLoop, host.mAddr);
+                } catch (...) {
+                    --host.mTotal;
+                    host.wakeOne();
+                    throw;
+                }
+                co_return PooledConnection(FileStream(mLoop, std::move(file)),
+                                           &host);
+            }
+            co_await ConnectionPoolHost::Waiter(host);
+        }
+    }
+
+    // 响应完整读完后调用，连接回到空闲列表等待复用；
+    // 缓冲区中还有未读的数据时，下一个使用者会把它当作自己的响应，
+    // 这样的连接直接关闭
+    void release(PooledConnection &&conn) {
+        if (conn.mStream.buffered() != 0) [[unlikely]] {
+            PooledConnection discard(std::move(conn));
+            return;
+        }
+        ConnectionPoolHost *host = std::exchange(conn.mHost, nullptr);
+        if (!host) [[unlikely]] {
+            return;
+        }
+        host->mIdle.push_back({std::move(conn.mStream),
+                               std::chrono::system_clock::now() +
+                                   mIdleTimeout});
+        host->wakeOne();
+    }
+
+    std::size_t idleConnections() const noexcept {
+        std::size_t count = 0;
+        for (auto const &[key, host]: mHosts) {
+            count += host.mIdle.size();
+        }
+        return count;
+    }
+
+    // 定期清理超时的空闲连接，与业务协程一同 when_any 运行
+    Task<> evict_idle() {
+        while (true) {
+            co_await sleep_for(mTimer, mIdleTimeout);
+            auto now = std::chrono::system_clock::now();
+            for (auto &[key, host]: mHosts) {
+                evictExpired(host, now);
+            }
+        }
+    }
+
+private:
+    ConnectionPoolHost &hostOf(SocketAddress const &addr) {
+        std::string key((char const *)&addr.mAddr, addr.mAddrLen);
+        auto [it, inserted] = mHosts.try_emplace(std::move(key));
+        if (inserted) {
+            it->second.mAddr = addr;
+        }
+        return it->second;
+    }
+
+    void evictExpired(ConnectionPoolHost &host,
+                      std::chrono::system_clock::time_point now) {
+        // 空闲列表按归还时间有序，过期的都在前面
+        std::size_t n = 0;
+        while (n < host.mIdle.size() && host.mIdle[n].mExpireTime <= now) {
+            ++n;
+        }
+        if (n) {
+            host.mIdle.erase(host.mIdle.begin(), host.mIdle.begin() + n);
+            host.mTotal -= n;
+            for (std::size_t i = 0; i < n; ++i) {
+                host.wakeOne();
+            }
+        }
+    }
+
+    // 空闲连接上不应有数据，可读说明对端已关闭或协议错乱
+    static bool isAlive(AsyncFile &file) {
+        char c;
+        ssize_t res = recv(file.fileNo(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        return res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
+    EpollLoop &mLoop;
+    TimerLoop &mTimer;
+    std::size_t mMaxPerHost;
+    std::chrono::system_clock::duration mIdleTimeout;
+    std::map<std::string, ConnectionPoolHost, std::less<>> mHosts;
+};
+
+} // namespace co_async
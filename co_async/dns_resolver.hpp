@@ -0,0 +1,503 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <co_async/task.hpp>
+#include <co_async/async_loop.hpp>
+#include <co_async/limit_timeout.hpp>
+#include <co_async/socket.hpp>
+#include <co_async/wait_queue.hpp>
+
+namespace co_async {
+
+struct DnsCacheEntry {
+    std::vector<IpAddress> mAddrs; // 为空表示否定缓存
+    std::chrono::system_clock::time_point mExpireTime;
+};
+
+// 同名查询只发一次，其余协程挂在这里等结果
+struct DnsInflight {
+    // 结果在唤醒时复制到等待者里，恢复时 DnsInflight 可能已经销毁
+    struct Waiter : WaitQueueNode {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            mCoroutine = coroutine;
+            mInflight.mWaiters.pushBack(this);
+        }
+
+        std::vector<IpAddress> await_resume() {
+            if (mException) [[unlikely]] {
+                std::rethrow_exception(mException);
+            }
+            return std::move(mAddrs);
+        }
+
+        explicit Waiter(DnsInflight &inflight) noexcept
+            : mInflight(inflight) {}
+
+        Waiter(Waiter &&) = delete;
+
+        // 等待者自身被取消时从队列中移除
+        ~Waiter() {
+            unlink();
+        }
+
+        DnsInflight &mInflight;
+        std::vector<IpAddress> mAddrs;
+        std::exception_ptr mException{};
+    };
+
+    DnsInflight() = default;
+    DnsInflight(DnsInflight &&) = delete;
+
+    // 经 ReadyQueue 恢复，不在发起查询的协程的析构过程中嵌套执行
+    void wakeAll() {
+        while (WaitQueueNode *node = mWaiters.popFront()) {
+            auto *waiter = static_cast<Waiter *>(node);
+            if (mException) [[unlikely]] {
+                waiter->mException = mException;
+            } else {
+                waiter->mAddrs = mAddrs;
+            }
+            ReadyQueue::current().wake(waiter);
+        }
+    }
+
+    WaitQueue mWaiters;
+    std::vector<IpAddress> mAddrs;
+    std::exception_ptr mException{};
+    bool mDone = false;
+};
+
+struct DnsResolverOptions {
+    std::chrono::system_clock::duration mTimeout = std::chrono::seconds(5);
+    int mAttempts = 2;
+    // 否定缓存时长的上限，应答中没有 SOA 时也用它
+    std::chrono::system_clock::duration mNegativeTtl =
+        std::chrono::seconds(30);
+    std::chrono::system_clock::duration mMaxTtl = std::chrono::hours(1);
+    // 应答中取不到地址记录的 TTL 时的缓存时长
+    std::chrono::system_clock::duration mDefaultTtl = std::chrono::seconds(60);
+};
+
+struct DnsResolver {
+    // 从 /etc/resolv.conf 与 /etc/hosts 读取配置
+    explicit DnsResolver(AsyncLoop &loop) : mLoop(loop) {
+        loadResolvConf("/etc/resolv.conf");
+        loadHosts("/etc/hosts");
+    }
+
+    // 指定名字服务器，便于对接本地桩服务器
+    explicit DnsResolver(AsyncLoop &loop,
+                         std::vector<SocketAddress> nameservers,
+                         DnsResolverOptions options = {})
+        : mLoop(loop),
+          mNameservers(std::move(nameservers)),
+          mOptions(options) {}
+
+    DnsResolver &operator=(DnsResolver &&) = delete;
+
+    void add_host(std::string name, IpAddress addr) {
+        lowercase(name);
+        mHosts[std::move(name)].push_back(addr);
+    }
+
+    void clear_cache() noexcept {
+        mCache.clear();
+    }
+
+    Task<std::vector<IpAddress>> resolve(std::string name) {
+        lowercase(name);
+        if (!name.empty() && name.back() == '.') {
+            name.pop_back();
+        }
+        in_addr addr = {};
+        in6_addr addr6 = {};
+        if (inet_pton(AF_INET, name.c_str(), &addr) == 1) {
+            co_return std::vector<IpAddress>{addr};
+        }
+        if (inet_pton(AF_INET6, name.c_str(), &addr6) == 1) {
+            co_return std::vector<IpAddress>{addr6};
+        }
+        if (auto it = mHosts.find(name); it != mHosts.end()) {
+            co_return it->second;
+        }
+        if (auto it = mCache.find(name); it != mCache.end()) {
+            if (it->second.mExpireTime > std::chrono::system_clock::now()) {
+                if (it->second.mAddrs.empty()) {
+                    throw std::invalid_argument("domain name not found");
+                }
+                co_return it->second.mAddrs;
+            }
+            mCache.erase(it);
+        }
+        if (auto it = mInflight.find(name); it != mInflight.end()) {
+            co_return co_await DnsInflight::Waiter(it->second);
+        }
+        InflightGuard guard{mInflight, name};
+        DnsInflight &inflight = mInflight[name];
+        try {
+            inflight.mAddrs = co_await lookup(name);
+        } catch (...) {
+            inflight.mException = std::current_exception();
+        }
+        inflight.mDone = true;
+        if (inflight.mException) {
+            std::rethrow_exception(inflight.mException);
+        }
+        co_return inflight.mAddrs;
+    }
+
+    std::size_t cacheSize() const noexcept {
+        return mCache.size();
+    }
+
+private:
+    static constexpr std::uint16_t kTypeA = 1;
+    static constexpr std::uint16_t kTypeSOA = 6;
+    static constexpr std::uint16_t kTypeAAAA = 28;
+
+    // 发起查询的协程结束或被取消时，唤醒所有同名等待者
+    struct InflightGuard {
+        std::map<std::string, DnsInflight, std::less<>> &mMap;
+        std::string const &mName;
+
+        ~InflightGuard() {
+            auto node = mMap.extract(mName);
+            DnsInflight &inflight = node.mapped();
+            if (!inflight.mDone) {
+                inflight.mException = std::make_exception_ptr(
+                    std::runtime_error("dns lookup cancelled"));
+            }
+            inflight.wakeAll();
+        }
+    };
+
+    struct Answer {
+        int mRcode = -1;
+        std::vector<IpAddress> mAddrs;
+        // 地址记录中最小的 TTL
+        std::optional<std::uint32_t> mTtl;
+        // 否定应答的 SOA 给出的缓存时长
+        std::optional<std::uint32_t> mNegativeTtl;
+    };
+
+    static void lowercase(std::string &s) {
+        for (auto &c: s) {
+            if (c >= 'A' && c <= 'Z') {
+                c += 'a' - 'A';
+            }
+        }
+    }
+
+    void loadResolvConf(char const *path) {
+        std::ifstream fin(path);
+        std::string line;
+        while (std::getline(fin, line)) {
+            std::istringstream ss(line);
+            std::string key, value;
+            ss >> key;
+            if (key == "nameserver") {
+                ss >> value;
+                in_addr addr = {};
+                in6_addr addr6 = {};
+                if (inet_pton(AF_INET, value.c_str(), &addr) == 1) {
+                    mNameservers.emplace_back(addr, 53);
+                } else if (inet_pton(AF_INET6, value.c_str(), &addr6) == 1) {
+                    mNameservers.emplace_back(addr6, 53);
+                }
+            } else if (key == "options") {
+                while (ss >> value) {
+                    if (value.starts_with("timeout:")) {
+                        mOptions.mTimeout =
+                            std::chrono::seconds(std::atoi(value.c_str() + 8));
+                    } else if (value.starts_with("attempts:")) {
+                        mOptions.mAttempts = std::atoi(value.c_str() + 9);
+                    }
+                }
+            }
+        }
+        if (mNameservers.empty()) {
+            mNameservers.push_back(socket_address(ip_address("127.0.0.1"), 53));
+        }
+    }
+
+    void loadHosts(char const *path) {
+        std::ifstream fin(path);
+        std::string line;
+        while (std::getline(fin, line)) {
+            if (auto pos = line.find('#'); pos != line.npos) {
+                line.resize(pos);
+            }
+            std::istringstream ss(line);
+            std::string ip, name;
+            if (!(ss >> ip)) {
+                continue;
+            }
+            in_addr addr = {};
+            in6_addr addr6 = {};
+            std::optional<IpAddress> ipAddr;
+            if (inet_pton(AF_INET, ip.c_str(), &addr) == 1) {
+                ipAddr.emplace(addr);
+            } else if (inet_pton(AF_INET6, ip.c_str(), &addr6) == 1) {
+                ipAddr.emplace(addr6);
+            } else {
+                continue;
+            }
+            while (ss >> name) {
+                add_host(std::move(name), *ipAddr);
+            }
+        }
+    }
+
+    static std::string encodeQuery(std::uint16_t id, std::string_view name,
+                                   std::uint16_t type) {
+        std::string q;
+        q.reserve(18 + name.size());
+        auto putU16 = [&](std::uint16_t v) {
+            q.push_back((char)(v >> 8));
+            q.push_back((char)(v & 0xff));
+        };
+        putU16(id);
+        putU16(0x0100); // RD
+        putU16(1);
+        putU16(0);
+        putU16(0);
+        putU16(0);
+        while (!name.empty()) {
+            auto dot = name.find('.');
+            auto label = name.substr(0, dot);
+            if (label.empty() || label.size() > 63) [[unlikely]] {
+                throw std::invalid_argument("invalid domain name");
+            }
+            q.push_back((char)label.size());
+            q.append(label);
+            name = dot == name.npos ? std::string_view() : name.substr(dot + 1);
+        }
+        q.push_back('\0');
+        putU16(type);
+        putU16(1); // IN
+        return q;
+    }
+
+    struct Parser {
+        std::string_view mData;
+        std::size_t mPos = 0;
+
+        bool ok(std::size_t n) const noexcept {
+            return mPos + n <= mData.size();
+        }
+
+        std::uint16_t u16() {
+            if (!ok(2)) [[unlikely]] {
+                throw std::invalid_argument("truncated dns message");
+            }
+            std::uint16_t v = (std::uint8_t)mData[mPos] << 8 |
+                              (std::uint8_t)mData[mPos + 1];
+            mPos += 2;
+            return v;
+        }
+
+        std::uint32_t u32() {
+            std::uint32_t hi = u16();
+            return hi << 16 | u16();
+        }
+
+        void skipName() {
+            while (true) {
+                if (!ok(1)) [[unlikely]] {
+                    throw std::invalid_argument("truncated dns message");
+                }
+                std::uint8_t len = mData[mPos];
+                if ((len & 0xc0) == 0xc0) {
+                    mPos += 2;
+                    return;
+                }
+                mPos += 1 + len;
+                if (len == 0) {
+                    return;
+                }
+            }
+        }
+    };
+
+    // 过短或格式错误的数据报当作无关的包忽略 (mRcode 为 -1)，
+    // 不让一个异常的 UDP 包中止整次查询
+    static Answer parseAnswer(std::string_view data, std::uint16_t id) {
+        try {
+            return parseMessage(data, id);
+        } catch (std::invalid_argument const &) {
+            return Answer();
+        }
+    }
+
+    static Answer parseMessage(std::string_view data, std::uint16_t id) {
+        Answer ans;
+        Parser p{data};
+        if (p.u16() != id) {
+            return ans;
+        }
+        std::uint16_t flags = p.u16();
+        if (!(flags & 0x8000)) {
+            return ans;
+        }
+        std::uint16_t qd = p.u16(), an = p.u16(), ns = p.u16();
+        p.u16();
+        for (std::uint16_t i = 0; i < qd; ++i) {
+            p.skipName();
+            p.mPos += 4;
+        }
+        for (std::uint32_t i = 0; i < (std::uint32_t)an + ns; ++i) {
+            p.skipName();
+            std::uint16_t type = p.u16();
+            p.u16();
+            std::uint32_t ttl = p.u32();
+            std::uint16_t len = p.u16();
+            if (!p.ok(len)) [[unlikely]] {
+                throw std::invalid_argument("truncated dns message");
+            }
+            std::size_t next = p.mPos + len;
+            if (i < an && type == kTypeA && len == sizeof(in_addr)) {
+                in_addr addr;
+                std::memcpy(&addr, data.data() + p.mPos, sizeof(addr));
+                ans.mAddrs.emplace_back(addr);
+                ans.mTtl = std::min(ans.mTtl.value_or(ttl), ttl);
+            } else if (i < an && type == kTypeAAAA &&
+                       len == sizeof(in6_addr)) {
+                in6_addr addr6;
+                std::memcpy(&addr6, data.data() + p.mPos, sizeof(addr6));
+                ans.mAddrs.emplace_back(addr6);
+                ans.mTtl = std::min(ans.mTtl.value_or(ttl), ttl);
+            } else if (i >= an && type == kTypeSOA && ans.mAddrs.empty()) {
+                // 否定应答的缓存时间取 SOA 的 TTL 与 MINIMUM 较小者 (RFC 2308)
+                p.skipName();
+                p.skipName();
+                p.mPos += 16;
+                std::uint32_t minimum = p.u32();
+                ans.mNegativeTtl = std::min(ttl, minimum);
+            }
+            p.mPos = next;
+        }
+        ans.mRcode = flags & 0x000f;
+        return ans;
+    }
+
+    // 向一个名字服务器同时查询 A 与 AAAA
+    Task<std::optional<Answer>> queryServer(SocketAddress const &server,
+                                            std::string const &name) {
+        AsyncFile sock(
+            checkError(socket(server.mAddr.ss_family, SOCK_DGRAM, 0)));
+        sock.setNonblock();
+        checkError(connect(sock.fileNo(), (sockaddr const *)&server.mAddr,
+                           server.mAddrLen));
+        std::uint16_t ids[2] = {(std::uint16_t)mRandom(),
+                                (std::uint16_t)mRandom()};
+        std::uint16_t types[2] = {kTypeA, kTypeAAAA};
+        bool done[2] = {false, false};
+        for (int i = 0; i < 2; ++i) {
+            auto q = encodeQuery(ids[i], name, types[i]);
+            co_await write_file(mLoop, sock, q);
+        }
+        Answer result;
+        result.mRcode = 0;
+        char buf[1232];
+        while (!done[0] || !done[1]) {
+            auto len = co_await read_file(mLoop, sock, buf);
+            std::string_view data(buf, len);
+            for (int i = 0; i < 2; ++i) {
+                if (done[i]) {
+                    continue;
+                }
+                Answer ans = parseAnswer(data, ids[i]);
+                if (ans.mRcode == -1) {
+                    continue;
+                }
+                if (ans.mRcode != 0 && ans.mRcode != 3) {
+                    co_return std::nullopt; // SERVFAIL 等，换下一个服务器
+                }
+                done[i] = true;
+                if (ans.mRcode == 3) {
+                    result.mRcode = 3;
+                }
+                result.mAddrs.insert(result.mAddrs.end(), ans.mAddrs.begin(),
+                                     ans.mAddrs.end());
+                if (ans.mTtl) {
+                    result.mTtl = std::min(result.mTtl.value_or(*ans.mTtl),
+                                           *ans.mTtl);
+                }
+                if (ans.mNegativeTtl) {
+                    auto ttl = *ans.mNegativeTtl;
+                    result.mNegativeTtl =
+                        std::min(result.mNegativeTtl.value_or(ttl), ttl);
+                }
+            }
+        }
+        co_return result;
+    }
+
+    Task<std::vector<IpAddress>> lookup(std::string const &name) {
+        for (int attempt = 0; attempt < mOptions.mAttempts; ++attempt) {
+            for (auto const &server: mNameservers) {
+                std::optional<std::optional<Answer>> res;
+                try {
+                    res = co_await limit_timeout(
+                        mLoop, queryServer(server, name), mOptions.mTimeout);
+                } catch (std::system_error const &) {
+                    continue; // 端口不可达等，换下一个服务器
+                }
+                if (!res || !*res) {
+                    continue;
+                }
+                Answer &ans = **res;
+                auto now = std::chrono::system_clock::now();
+                if (ans.mAddrs.empty()) {
+                    auto ttl = mOptions.mNegativeTtl;
+                    if (ans.mNegativeTtl) {
+                        ttl = std::min<std::chrono::system_clock::duration>(
+                            std::chrono::seconds(*ans.mNegativeTtl), ttl);
+                    }
+                    mCache.insert_or_assign(name, DnsCacheEntry{{}, now + ttl});
+                    throw std::invalid_argument("domain name not found");
+                }
+                // 只看地址记录的 TTL，另一种类型的否定应答不缩短它
+                std::chrono::system_clock::duration ttl = mOptions.mDefaultTtl;
+                if (ans.mTtl) {
+                    ttl = std::chrono::seconds(*ans.mTtl);
+                }
+                ttl = std::min(ttl, mOptions.mMaxTtl);
+                auto addrs = interleaveAddresses(ans.mAddrs);
+                mCache.insert_or_assign(name, DnsCacheEntry{addrs, now + ttl});
+                co_return addrs;
+            }
+        }
+        throw std::runtime_error("no dns server responded");
+    }
+
+    AsyncLoop &mLoop;
+    std::vector<SocketAddress> mNameservers;
+    DnsResolverOptions mOptions;
+    std::map<std::string, std::vector<IpAddress>, std::less<>> mHosts;
+    std::map<std::string, DnsCacheEntry, std::less<>> mCache;
+    std::map<std::string, DnsInflight, std::less<>> mInflight;
+    std::mt19937 mRandom{std::random_device{}()};
+};
+
+} // namespace co_async
@@ -7,11 +7,14 @@
 #include <optional>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <span>
 #include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <co_async/task.hpp>
 #include <co_async/error_handling.hpp>
+#include <co_async/expected.hpp>
+#include <co_async/stop_token.hpp>
 
 namespace co_async {
 
@@ -27,11 +30,12 @@ struct EpollFilePromise : Promise<EpollEventMask> {
     inline ~EpollFilePromise();
 
     struct EpollFileAwaiter *mAwaiter{};
+    std::uint64_t mBatch = 0;
 };
 
 struct EpollLoop {
-    inline void addListener(EpollFilePromise &promise, int ctl);
-    inline void removeListener(int fileNo);
+    inline void addListener(EpollFilePromise &promise);
+    inline void removeListener(EpollFilePromise &promise);
     inline bool run(std::optional<std::chrono::system_clock::duration> timeout =
                         std::nullopt);
 
@@ -45,51 +49,154 @@ struct EpollLoop {
         close(mEpoll);
     }
 
+    // 同一文件上可以同时有一个读等待者和一个写等待者，便于全双工收发
+    struct Registration {
+        EpollFilePromise *mIn{};
+        EpollFilePromise *mOut{};
+    };
+
+    inline void updateListener(int fileNo, Registration const &reg, int ctl);
+    inline void resumeListener(epoll_event const &event,
+                               EpollFilePromise *Registration::*slot);
+
     int mEpoll = checkError(epoll_create1(0));
     std::size_t mCount = 0;
+    std::uint64_t mBatch = 0;
+    std::unordered_map<int, Registration> mRegistrations;
     struct epoll_event mEventBuf[64];
 };
 
-struct EpollFileAwaiter {
+// 等待期间请求停止时从事件循环注销，经 ReadyQueue 恢复，
+// await_resume 随之抛出
+struct EpollFileAwaiter : StopCallbackNode {
+    EpollFileAwaiter(EpollLoop &loop, int fileNo, EpollEventMask events)
+        : StopCallbackNode(&EpollFileAwaiter::onStop),
+          mLoop(loop),
+          mFileNo(fileNo),
+          mEvents(events) {}
+
     bool await_ready() const noexcept {
         return false;
     }
 
-    void await_suspend(std::coroutine_handle<EpollFilePromise> coroutine) {
+    bool await_suspend(std::coroutine_handle<EpollFilePromise> coroutine) {
         auto &promise = coroutine.promise();
+        if (promise.mStopToken.stop_requested()) [[unlikely]] {
+            mStopped = true;
+            return false;
+        }
         promise.mAwaiter = this;
-        mLoop.addListener(promise, mCtlCode);
+        mLoop.addListener(promise);
+        this->mCoroutine = coroutine;
+        promise.mStopToken.attach(*this);
+        return true;
     }
 
-    EpollEventMask await_resume() const noexcept {
+    EpollEventMask await_resume() {
+        this->unlink();
+        if (mStopped) [[unlikely]] {
+            throwOperationCanceled();
+        }
         return mResumeEvents;
     }
 
     EpollLoop &mLoop;
     int mFileNo;
     EpollEventMask mEvents;
-    EpollEventMask mResumeEvents;
-    int mCtlCode = EPOLL_CTL_ADD;
+    EpollEventMask mResumeEvents{};
+    bool mStopped = false;
+
+private:
+    static void onStop(StopCallbackNode &node) {
+        auto &self = static_cast<EpollFileAwaiter &>(node);
+        auto coroutine = std::coroutine_handle<EpollFilePromise>::from_address(
+            self.mCoroutine.address());
+        self.mLoop.removeListener(coroutine.promise());
+        self.mStopped = true;
+        // 与 SleepAwaiter::onStop 相同，不在 request_stop 中嵌套恢复
+        ReadyQueue::current().wake(&self);
+    }
 };
 
 EpollFilePromise::~EpollFilePromise() {
     if (mAwaiter) [[likely]] {
-        mAwaiter->mLoop.removeListener(mAwaiter->mFileNo);
+        mAwaiter->mLoop.removeListener(*this);
     }
 }
 
-void EpollLoop::addListener(EpollFilePromise &promise, int ctl) {
+void EpollLoop::updateListener(int fileNo, Registration const &reg, int ctl) {
     struct epoll_event event;
-    event.events = promise.mAwaiter->mEvents;
-    event.data.ptr = &promise;
-    checkError(epoll_ctl(mEpoll, ctl, promise.mAwaiter->mFileNo, &event));
-    if (ctl == EPOLL_CTL_ADD)
-        ++mCount;
+    event.events = (reg.mIn ? reg.mIn->mAwaiter->mEvents : 0) |
+                   (reg.mOut ? reg.mOut->mAwaiter->mEvents : 0);
+    event.data.fd = fileNo;
+    checkError(epoll_ctl(mEpoll, ctl, fileNo, &event));
 }
 
-void EpollLoop::removeListener(int fileNo) {
-    checkError(epoll_ctl(mEpoll, EPOLL_CTL_DEL, fileNo, NULL));
+void EpollLoop::addListener(EpollFilePromise &promise) {
+    auto *awaiter = promise.mAwaiter;
+    auto [it, inserted] = mRegistrations.try_emplace(awaiter->mFileNo);
+    auto &reg = it->second;
+    bool out = (awaiter->mEvents & EPOLLOUT) && !(awaiter->mEvents & EPOLLIN);
+    auto *&slot = out ? reg.mOut : reg.mIn;
+    if (slot) [[unlikely]] {
+        throw std::system_error(EEXIST, std::system_category(),
+                                "file already has a waiter");
+    }
+    slot = &promise;
+    promise.mBatch = mBatch;
+    try {
+        updateListener(awaiter->mFileNo, reg,
+                       inserted ? EPOLL_CTL_ADD : EPOLL_CTL_MOD);
+    } catch (...) {
+        slot = nullptr;
+        if (inserted) {
+            mRegistrations.erase(it);
+        }
+        throw;
+    }
+    ++mCount;
+}
+
+void EpollLoop::removeListener(EpollFilePromise &promise) {
+    int fileNo = promise.mAwaiter->mFileNo;
+    auto it = mRegistrations.find(fileNo);
+    if (it == mRegistrations.end()) [[unlikely]] {
+        return;
+    }
+    auto &reg = it->second;
+    if (reg.mIn == &promise) {
+        reg.mIn = nullptr;
+    } else if (reg.mOut == &promise) {
+        reg.mOut = nullptr;
+    } else [[unlikely]] {
+        return; // 注册失败的等待者
+    }
     --mCount;
+    if (!reg.mIn && !reg.mOut) {
+        mRegistrations.erase(it);
+        checkError(epoll_ctl(mEpoll, EPOLL_CTL_DEL, fileNo, NULL));
+    } else {
+        updateListener(fileNo, reg, EPOLL_CTL_MOD);
+    }
+}
+
+// 先恢复的协程可能销毁或新注册同一文件上的等待者，因此每次都重新查找；
+// 本批次中新注册的等待者不会被这批旧事件唤醒
+void EpollLoop::resumeListener(epoll_event const &event,
+                               EpollFilePromise *Registration::*slot) {
+    auto it = mRegistrations.find(event.data.fd);
+    if (it == mRegistrations.end()) {
+        return;
+    }
+    auto *promise = it->second.*slot;
+    if (!promise || promise->mBatch == mBatch ||
+        !(event.events &
+          (promise->mAwaiter->mEvents | EPOLLERR | EPOLLHUP))) {
+        return;
+    }
+    promise->mAwaiter->mResumeEvents = event.events;
+    ReadyQueue::current().resume(
+        std::coroutine_handle<EpollFilePromise>::from_promise(*promise));
 }
 
 bool EpollLoop::run(
@@ -105,15 +212,10 @@ bool EpollLoop::run(
     }
     int res = checkError(
         epoll_wait(mEpoll, mEventBuf, std::size(mEventBuf), timeoutInMs));
+    ++mBatch;
     for (int i = 0; i < res; i++) {
-        auto &event = mEventBuf[i];
-        auto &promise = *(EpollFilePromise *)event.data.ptr;
-        promise.mAwaiter->mResumeEvents = event.events;
-    }
-    for (int i = 0; i < res; i++) {
-        auto &event = mEventBuf[i];
-        auto &promise = *(EpollFilePromise *)event.data.ptr;
-        std::coroutine_handle<EpollFilePromise>::from_promise(promise).resume();
+        resumeListener(mEventBuf[i], &Registration::mIn);
+        resumeListener(mEventBuf[i], &Registration::mOut);
     }
     return true;
 }
@@ -186,4 +288,35 @@ inline Task<std::size_t> write_file(EpollLoop &loop, AsyncFile &file,
     co_return len;
 }
 
+// 不抛出的版本：出错时返回错误码，被虚假唤醒 (EAGAIN) 时继续等待，
+// 而不是像 read_file 那样返回 0 让调用者误以为对端已关闭
+inline Task<Expected<std::size_t>>
+try_read_file(EpollLoop &loop, AsyncFile &file, std::span<char> buffer) {
+    while (true) {
+        co_await wait_file_event(loop, file, EPOLLIN | EPOLLRDHUP);
+        auto len = read(file.fileNo(), buffer.data(), buffer.size());
+        if (len != -1) [[likely]] {
+            co_return static_cast<std::size_t>(len);
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            co_return errnoError();
+        }
+    }
+}
+
+inline Task<Expected<std::size_t>>
+try_write_file(EpollLoop &loop, AsyncFile &file,
+               std::span<char const> buffer) {
+    while (true) {
+        co_await wait_file_event(loop, file, EPOLLOUT | EPOLLHUP);
+        auto len = write(file.fileNo(), buffer.data(), buffer.size());
+        if (len != -1) [[likely]] {
+            co_return static_cast<std::size_t>(len);
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            co_return errnoError();
+        }
+    }
+}
+
 } // namespace co_async
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cerrno>
+#include <exception>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <co_async/task.hpp>
+#include <co_async/uninitialized.hpp>
+
+namespace co_async {
+
+struct EOFException {};
+
+enum class StreamError {
+    EndOfFile = 1,
+};
+
+inline std::error_category const &stream_category() noexcept {
+    static struct : std::error_category {
+        char const *name() const noexcept override {
+            return "co_async.stream";
+        }
+
+        std::string message(int value) const override {
+            if (static_cast<StreamError>(value) == StreamError::EndOfFile) {
+                return "end of file";
+            }
+            return "unknown stream error";
+        }
+    } category;
+    return category;
+}
+
+inline std::error_code make_error_code(StreamError e) noexcept {
+    return std::error_code(static_cast<int>(e), stream_category());
+}
+
+} // namespace co_async
+
+template <>
+struct std::is_error_code_enum<co_async::StreamError> : std::true_type {};
+
+namespace co_async {
+
+inline std::error_code errnoError() noexcept {
+    return std::error_code(errno, std::system_category());
+}
+
+// 值或错误码，对端关闭与系统调用失败都作为普通的返回值，不经过异常；
+// value() 在出错时抛出原来的异常 (EOFException 或 system_error)
+template <class T = void>
+struct [[nodiscard]] Expected {
+    Expected(T value) : mValue(std::move(value)) {}
+
+    Expected(std::error_code error) noexcept : mError(error) {}
+
+    Expected(StreamError error) noexcept : mError(error) {}
+
+    bool has_value() const noexcept {
+        return mValue.has_value();
+    }
+
+    explicit operator bool() const noexcept {
+        return has_value();
+    }
+
+    T &operator*() noexcept {
+        return *mValue;
+    }
+
+    T const &operator*() const noexcept {
+        return *mValue;
+    }
+
+    T *operator->() noexcept {
+        return mValue.operator->();
+    }
+
+    T const *operator->() const noexcept {
+        return mValue.operator->();
+    }
+
+    std::error_code error() const noexcept {
+        return mError;
+    }
+
+    bool eof() const noexcept {
+        return mError == StreamError::EndOfFile;
+    }
+
+    T value() && {
+        if (!mValue) [[unlikely]] {
+            throwError();
+        }
+        return std::move(*mValue);
+    }
+
+    void throwError() const {
+        if (eof()) {
+            throw EOFException();
+        }
+        throw std::system_error(mError);
+    }
+
+private:
+    std::optional<T> mValue;
+    std::error_code mError;
+};
+
+template <>
+struct [[nodiscard]] Expected<void> {
+    Expected() noexcept = default;
+
+    Expected(std::error_code error) noexcept : mError(error) {}
+
+    Expected(StreamError error) noexcept : mError(error) {}
+
+    bool has_value() const noexcept {
+        return !mError;
+    }
+
+    explicit operator bool() const noexcept {
+        return has_value();
+    }
+
+    std::error_code error() const noexcept {
+        return mError;
+    }
+
+    bool eof() const noexcept {
+        return mError == StreamError::EndOfFile;
+    }
+
+    void value() const {
+        if (mError) [[unlikely]] {
+            throwError();
+        }
+    }
+
+    void throwError() const {
+        if (eof()) {
+            throw EOFException();
+        }
+        throw std::system_error(mError);
+    }
+
+private:
+    std::error_code mError;
+};
+
+// Task<Expected<T>> 的 promise：协程内逃出的 EOFException 与 system_error
+// 在这里转为错误码，只展开这一层，不再经 exception_ptr 逐层重新抛出；
+// 其他异常照常传递
+template <class T>
+struct Promise<Expected<T>> {
+    auto initial_suspend() noexcept {
+        return std::suspend_always();
+    }
+
+    auto final_suspend() noexcept {
+        return PreviousAwaiter(mPrevious, mHook);
+    }
+
+    void unhandled_exception() noexcept {
+        try {
+            throw;
+        } catch (EOFException const &) {
+            mResult.putValue(StreamError::EndOfFile);
+        } catch (std::system_error const &e) {
+            mResult.putValue(e.code());
+        } catch (...) {
+            mException = std::current_exception();
+        }
+    }
+
+    void return_value(Expected<T> &&ret) {
+        mResult.putValue(std::move(ret));
+    }
+
+    void return_value(Expected<T> const &ret) {
+        mResult.putValue(ret);
+    }
+
+    Expected<T> result() {
+        if (mException) [[unlikely]] {
+            std::rethrow_exception(mException);
+        }
+        return mResult.moveValue();
+    }
+
+    auto get_return_object() {
+        return std::coroutine_handle<Promise>::from_promise(*this);
+    }
+
+    std::coroutine_handle<> mPrevious;
+    CompletionHook *mHook = nullptr;
+    Uninitialized<Expected<T>> mResult;
+    std::exception_ptr mException{};
+    StopToken mStopToken{};
+
+    Promise &operator=(Promise &&) = delete;
+};
+
+} // namespace co_async
@@ -14,6 +14,7 @@
 #include <co_async/task.hpp>
 #include <co_async/epoll_loop.hpp>
 #include <co_async/error_handling.hpp>
+#include <co_async/stream_base.hpp>
 
 namespace co_async {
 
@@ -33,4 +34,24 @@ inline Task<AsyncFile> open_fs_file(EpollLoop &loop, std::filesystem::path path,
     co_return file;
 }
 
+// 普通文件总是就绪且不能加入 epoll，直接同步读写
+struct FsFileBuf {
+    AsyncFile mFile;
+
+    explicit FsFileBuf(AsyncFile &&file) noexcept : mFile(std::move(file)) {}
+
+    FsFileBuf() = default;
+
+    Task<std::size_t> read(std::span<char> buffer) {
+        co_return readFileSync(mFile, buffer);
+    }
+
+    Task<std::size_t> write(std::span<char const> buffer) {
+        co_return writeFileSync(mFile, buffer);
+    }
+};
+
+using FsFileIStream = IStream<FsFileBuf>;
+using FsFileOStream = OStream<FsFileBuf>;
+
 }
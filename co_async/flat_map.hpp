@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <utility>
+
+namespace co_async {
+
+// 按插入顺序存放在连续数组中的小型映射，前 N 项存放在对象内部不分配内存；
+// 查找为线性扫描，适合 HTTP 头部这类通常只有十几项的场合
+template <class K, class V, std::size_t N = 16, class Equal = std::equal_to<>>
+struct FlatMap {
+    static_assert(N != 0);
+
+    using value_type = std::pair<K, V>;
+
+    FlatMap() noexcept = default;
+
+    FlatMap(std::initializer_list<value_type> init) {
+        reserve(init.size());
+        for (auto const &[k, v]: init) {
+            insert_or_assign(k, v);
+        }
+    }
+
+    FlatMap(FlatMap &&that) noexcept {
+        moveFrom(that);
+    }
+
+    FlatMap(FlatMap const &that) {
+        reserve(that.mSize);
+        for (auto const &[k, v]: that) {
+            emplaceBack(k, v);
+        }
+    }
+
+    FlatMap &operator=(FlatMap &&that) noexcept {
+        if (this != &that) [[likely]] {
+            destroy();
+            moveFrom(that);
+        }
+        return *this;
+    }
+
+    FlatMap &operator=(FlatMap const &that) {
+        if (this != &that) [[likely]] {
+            clear();
+            reserve(that.mSize);
+            for (auto const &[k, v]: that) {
+                emplaceBack(k, v);
+            }
+        }
+        return *this;
+    }
+
+    ~FlatMap() {
+        destroy();
+    }
+
+    template <class Key>
+    V *at(Key const &key) noexcept {
+        auto *p = find(key);
+        return p ? std::addressof(p->second) : nullptr;
+    }
+
+    template <class Key>
+    V const *at(Key const &key) const noexcept {
+        auto *p = find(key);
+        return p ? std::addressof(p->second) : nullptr;
+    }
+
+    V &insert_or_assign(K key, V value) {
+        if (auto *p = find(key)) {
+            p->second = std::move(value);
+            return p->second;
+        }
+        return emplaceBack(std::move(key), std::move(value)).second;
+    }
+
+    // 键已存在时保留原值
+    V &insert(K key, V value) {
+        if (auto *p = find(key)) {
+            return p->second;
+        }
+        return emplaceBack(std::move(key), std::move(value)).second;
+    }
+
+    // 不检查键是否已存在，调用者须自行保证
+    value_type &emplace_back(K key, V value) {
+        return emplaceBack(std::move(key), std::move(value));
+    }
+
+    template <class Key>
+    bool contains(Key const &key) const noexcept {
+        return find(key) != nullptr;
+    }
+
+    // 后面的项前移以保持插入顺序
+    template <class Key>
+    bool erase(Key const &key) {
+        auto *p = find(key);
+        if (!p) {
+            return false;
+        }
+        std::move(p + 1, mData + mSize, p);
+        --mSize;
+        std::destroy_at(mData + mSize);
+        return true;
+    }
+
+    // 清空但保留已分配的容量
+    void clear() noexcept {
+        std::destroy(mData, mData + mSize);
+        mSize = 0;
+    }
+
+    void reserve(std::size_t n) {
+        if (n > mCapacity) {
+            grow(n);
+        }
+    }
+
+    std::size_t size() const noexcept {
+        return mSize;
+    }
+
+    bool empty() const noexcept {
+        return mSize == 0;
+    }
+
+    value_type const *begin() const noexcept {
+        return mData;
+    }
+
+    value_type const *end() const noexcept {
+        return mData + mSize;
+    }
+
+    value_type *begin() noexcept {
+        return mData;
+    }
+
+    value_type *end() noexcept {
+        return mData + mSize;
+    }
+
+private:
+    value_type *inlineData() noexcept {
+        return std::launder(reinterpret_cast<value_type *>(mInline));
+    }
+
+    template <class Key>
+    value_type *find(Key const &key) const noexcept {
+        Equal eq;
+        for (std::size_t i = 0; i < mSize; ++i) {
+            if (eq(mData[i].first, key)) {
+                return mData + i;
+            }
+        }
+        return nullptr;
+    }
+
+    template <class... Args>
+    value_type &emplaceBack(Args &&...args) {
+        if (mSize == mCapacity) [[unlikely]] {
+            grow(mCapacity * 2);
+        }
+        value_type *p =
+            std::construct_at(mData + mSize, std::forward<Args>(args)...);
+        ++mSize;
+        return *p;
+    }
+
+    void grow(std::size_t capacity) {
+        std::allocator<value_type> alloc;
+        value_type *data = alloc.allocate(capacity);
+        std::uninitialized_move(mData, mData + mSize, data);
+        std::destroy(mData, mData + mSize);
+        if (mData != inlineData()) {
+            alloc.deallocate(mData, mCapacity);
+        }
+        mData = data;
+        mCapacity = capacity;
+    }
+
+    void destroy() noexcept {
+        std::destroy(mData, mData + mSize);
+        if (mData != inlineData()) {
+            std::allocator<value_type>().deallocate(mData, mCapacity);
+        }
+        mData = inlineData();
+        mSize = 0;
+        mCapacity = N;
+    }
+
+    // 调用前本对象须为空且使用内部存储
+    void moveFrom(FlatMap &that) noexcept {
+        if (that.mData != that.inlineData()) {
+            mData = std::exchange(that.mData, that.inlineData());
+            mSize = std::exchange(that.mSize, 0);
+            mCapacity = std::exchange(that.mCapacity, N);
+        } else {
+            std::uninitialized_move(that.mData, that.mData + that.mSize,
+                                    mData);
+            mSize = that.mSize;
+            that.clear();
+        }
+    }
+
+    alignas(value_type) unsigned char mInline[N * sizeof(value_type)];
+    value_type *mData = inlineData();
+    std::size_t mSize = 0;
+    std::size_t mCapacity = N;
+};
+
+// ASCII 大小写不敏感的键比较，HTTP 头部名不区分大小写 (RFC 9110 5.1)
+struct HTTPKeyEqual {
+    bool operator()(std::string_view a, std::string_view b) const noexcept {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            char x = a[i], y = b[i];
+            if (x != y) {
+                // 只有字母才允许相差 0x20
+                if ((x ^ y) != 0x20 ||
+                    unsigned((x | 0x20) - 'a') > unsigned('z' - 'a')) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace co_async
@@ -1,11 +1,18 @@
 #pragma once
 
+#include <cstddef>
 #include <exception>
 #include <coroutine>
+#include <iterator>
+#include <memory>
 #include <optional>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
 #include <co_async/uninitialized.hpp>
 #include <co_async/previous_awaiter.hpp>
+#include <co_async/stop_token.hpp>
 
 namespace co_async {
 
@@ -16,7 +23,7 @@ struct GeneratorPromise {
     }
 
     auto final_suspend() noexcept {
-        return PreviousAwaiter(mPrevious);
+        return PreviousAwaiter(mPrevious, mHook);
     }
 
     void unhandled_exception() noexcept {
@@ -26,12 +33,12 @@ struct GeneratorPromise {
 
     auto yield_value(T &&ret) {
         mResult.putValue(std::move(ret));
-        return PreviousAwaiter(mPrevious);
+        return PreviousAwaiter(mPrevious, mHook);
     }
 
     auto yield_value(T const &ret) {
         mResult.putValue(ret);
-        return PreviousAwaiter(mPrevious);
+        return PreviousAwaiter(mPrevious, mHook);
     }
 
     void return_void() {
@@ -56,9 +63,11 @@ struct GeneratorPromise {
     }
 
     std::coroutine_handle<> mPrevious;
+    CompletionHook *mHook = nullptr;
     bool mFinal = false;
     Uninitialized<T> mResult;
     std::exception_ptr mException{};
+    StopToken mStopToken{};
 
     GeneratorPromise &operator=(GeneratorPromise &&) = delete;
 };
@@ -70,7 +79,7 @@ struct GeneratorPromise<T &> {
     }
 
     auto final_suspend() noexcept {
-        return PreviousAwaiter(mPrevious);
+        return PreviousAwaiter(mPrevious, mHook);
     }
 
     void unhandled_exception() noexcept {
@@ -80,7 +89,7 @@ struct GeneratorPromise<T &> {
 
     auto yield_value(T &ret) {
         mResult = std::addressof(ret);
-        return PreviousAwaiter(mPrevious);
+        return PreviousAwaiter(mPrevious, mHook);
     }
 
     void return_void() {
@@ -106,14 +115,92 @@ struct GeneratorPromise<T &> {
     }
 
     std::coroutine_handle<> mPrevious{};
+    CompletionHook *mHook = nullptr;
     T *mResult;
     std::exception_ptr mException{};
+    StopToken mStopToken{};
 
     GeneratorPromise &operator=(GeneratorPromise &&) = delete;
 };
 
+// 同步遍历生成器，用于 range-for 与 std::views。每次 ++ 恢复生成器一次，
+// 它在 co_yield 处挂起后立即返回；生成器若在 co_await 处挂起，
+// 此时并没有产出值，与 GeneratorPipe 相同抛出 std::logic_error
+template <class T, class P>
+struct GeneratorIterator {
+    using value_type = std::remove_cvref_t<T>;
+    using difference_type = std::ptrdiff_t;
+
+    GeneratorIterator() = default;
+
+    explicit GeneratorIterator(std::coroutine_handle<P> coroutine)
+        : mCoroutine(coroutine) {
+        ++*this;
+    }
+
+    GeneratorIterator(GeneratorIterator &&) = default;
+    GeneratorIterator &operator=(GeneratorIterator &&) = default;
+
+    T &operator*() const noexcept {
+        if constexpr (std::is_reference_v<T>) {
+            return **mValue;
+        } else {
+            return *mValue;
+        }
+    }
+
+    GeneratorIterator &operator++() {
+        mValue.reset();
+        if (!mCoroutine) {
+            return *this;
+        }
+        // co_yield 与结束时都调用这个完成回调，随即回到这里
+        struct YieldHook : CompletionHook {
+            bool mTransferred = false;
+        } hook;
+        hook.mCallback = [](CompletionHook &h) noexcept
+            -> std::coroutine_handle<> {
+            static_cast<YieldHook &>(h).mTransferred = true;
+            return std::noop_coroutine();
+        };
+        auto &promise = mCoroutine.promise();
+        // 在 co_await 处挂起的生成器以后产出时不再恢复任何协程
+        promise.mPrevious = std::noop_coroutine();
+        promise.mHook = &hook;
+        mCoroutine.resume();
+        promise.mHook = nullptr;
+        if (!hook.mTransferred) [[unlikely]] {
+            throw std::logic_error(
+                "generator suspended outside co_yield during iteration");
+        }
+        if (!promise.final()) {
+            if constexpr (std::is_reference_v<T>) {
+                mValue.emplace(std::addressof(promise.result()));
+            } else {
+                mValue.emplace(promise.result());
+            }
+        }
+        return *this;
+    }
+
+    void operator++(int) {
+        ++*this;
+    }
+
+    friend bool operator==(GeneratorIterator const &it,
+                           std::default_sentinel_t) noexcept {
+        return !it.mValue;
+    }
+
+private:
+    std::coroutine_handle<P> mCoroutine;
+    mutable std::optional<std::conditional_t<
+        std::is_reference_v<T>, std::remove_reference_t<T> *, T>>
+        mValue;
+};
+
 template <class T, class P = GeneratorPromise<T>>
-struct [[nodiscard]] Generator {
+struct [[nodiscard]] Generator : std::ranges::view_base {
     using promise_type = P;
 
     Generator(std::coroutine_handle<promise_type> coroutine = nullptr) noexcept
@@ -125,6 +212,7 @@ struct [[nodiscard]] Generator {
 
     Generator &operator=(Generator &&that) noexcept {
         std::swap(mCoroutine, that.mCoroutine);
+        return *this;
     }
 
     ~Generator() {
@@ -137,9 +225,15 @@ struct [[nodiscard]] Generator {
             return false;
         }
 
+        template <class Q>
         std::coroutine_handle<promise_type>
-        await_suspend(std::coroutine_handle<> coroutine) const noexcept {
-            mCoroutine.promise().mPrevious = coroutine;
+        await_suspend(std::coroutine_handle<Q> coroutine) const noexcept {
+            promise_type &promise = mCoroutine.promise();
+            promise.mPrevious = coroutine;
+            if constexpr (requires { promise.mHook; }) {
+                promise.mHook = nullptr;
+            }
+            inherit_stop_token(stopTokenOf(coroutine));
             return mCoroutine;
         }
 
@@ -149,6 +243,16 @@ struct [[nodiscard]] Generator {
             return mCoroutine.promise().result();
         }
 
+        // 生成器内等待的任务沿用消费者的 StopToken，除非已经指定
+        void inherit_stop_token(StopToken token) const noexcept {
+            promise_type &promise = mCoroutine.promise();
+            if constexpr (requires { promise.mStopToken; }) {
+                if (!promise.mStopToken.stop_possible()) {
+                    promise.mStopToken = token;
+                }
+            }
+        }
+
         std::coroutine_handle<promise_type> mCoroutine;
     };
 
@@ -160,96 +264,17 @@ struct [[nodiscard]] Generator {
         return mCoroutine;
     }
 
-private:
-    std::coroutine_handle<promise_type> mCoroutine;
-};
-
-#if 0
-template <class T, class A, class LoopRef>
-struct GeneratorIterator {
-    using iterator_category = std::input_iterator_tag;
-    using value_type = T;
-    using difference_type = std::ptrdiff_t;
-    using pointer = T *;
-    using reference = T &;
-
-    explicit GeneratorIterator(A awaiter, LoopRef loop) noexcept
-        : mAwaiter(awaiter),
-          mLoop(loop) {
-        ++*this;
-    }
-
-    bool operator!=(std::default_sentinel_t) const noexcept {
-        return mResult.has_value();
-    }
-
-    bool operator==(std::default_sentinel_t) const noexcept {
-        return !(*this != std::default_sentinel);
+    // 只能遍历一次，begin 即开始运行生成器
+    GeneratorIterator<T, P> begin() const {
+        return GeneratorIterator<T, P>(mCoroutine);
     }
 
-    friend bool operator==(std::default_sentinel_t,
-                           GeneratorIterator const &it) noexcept {
-        return it == std::default_sentinel;
-    }
-
-    friend bool operator!=(std::default_sentinel_t,
-                           GeneratorIterator const &it) noexcept {
-        return it == std::default_sentinel;
-    }
-
-    GeneratorIterator &operator++() {
-        mAwaiter.mCoroutine.resume();
-        mLoop.run();
-        mResult = mAwaiter.await_resume();
-        return *this;
-    }
-
-    GeneratorIterator operator++(int) {
-        auto tmp = *this;
-        ++*this;
-        return tmp;
-    }
-
-    T &operator*() noexcept {
-        return *mResult;
-    }
-
-    T *operator->() noexcept {
-        return mResult.operator->();
+    std::default_sentinel_t end() const noexcept {
+        return {};
     }
 
 private:
-    A mAwaiter;
-    LoopRef mLoop;
-    std::optional<T> mResult;
-};
-
-template <class Loop, class T, class P>
-auto run_generator(Loop &loop, Generator<T, P> const &g) {
-    using Awaiter = typename Generator<T, P>::Awaiter;
-
-    struct GeneratorRange {
-        explicit GeneratorRange(Awaiter awaiter, Loop &loop)
-            : mAwaiter(awaiter),
-              mLoop(loop) {
-            mAwaiter.await_suspend(std::noop_coroutine());
-        }
-
-        auto begin() const noexcept {
-            return GeneratorIterator<T, Awaiter, Loop &>(mAwaiter, mLoop);
-        }
-
-        std::default_sentinel_t end() const noexcept {
-            return {};
-        }
-
-    private:
-        Awaiter mAwaiter;
-        Loop &mLoop;
-    };
-
-    return GeneratorRange(g.operator co_await(), loop);
+    std::coroutine_handle<promise_type> mCoroutine;
 };
-#endif
 
 } // namespace co_async
@@ -0,0 +1,435 @@
+#pragma once
+
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <co_async/generator.hpp>
+#include <co_async/previous_awaiter.hpp>
+
+namespace co_async {
+
+// 管道阶段的标记，map / filter / take / chunk 返回的对象都派生于它。
+// 阶段不是协程：Stage<In> 把输入推给下一阶段，closed 表示不再需要输入，
+// flush 在源生成器结束时推出积攒的数据
+struct PipeStageBase {};
+
+template <class F>
+struct PipeMap : PipeStageBase {
+    template <class In>
+    struct Stage {
+        using Output = std::remove_cvref_t<std::invoke_result_t<F &, In &&>>;
+
+        explicit Stage(PipeMap const &pipe) : mFunc(pipe.mFunc) {}
+
+        template <class Next>
+        void push(In &&value, Next &next) {
+            next.push(Output(std::invoke(mFunc, std::move(value))));
+        }
+
+        bool closed() const noexcept {
+            return false;
+        }
+
+        template <class Next>
+        void flush(Next &next) {
+            next.flush();
+        }
+
+        F mFunc;
+    };
+
+    F mFunc;
+};
+
+template <class F>
+struct PipeFilter : PipeStageBase {
+    template <class In>
+    struct Stage {
+        using Output = In;
+
+        explicit Stage(PipeFilter const &pipe) : mPred(pipe.mPred) {}
+
+        template <class Next>
+        void push(In &&value, Next &next) {
+            if (std::invoke(mPred, std::as_const(value))) {
+                next.push(std::move(value));
+            }
+        }
+
+        bool closed() const noexcept {
+            return false;
+        }
+
+        template <class Next>
+        void flush(Next &next) {
+            next.flush();
+        }
+
+        F mPred;
+    };
+
+    F mPred;
+};
+
+struct PipeTake : PipeStageBase {
+    template <class In>
+    struct Stage {
+        using Output = In;
+
+        explicit Stage(PipeTake const &pipe) noexcept : mLeft(pipe.mCount) {}
+
+        // 上游的 flush 可能在本阶段取够之后还推来数据
+        template <class Next>
+        void push(In &&value, Next &next) {
+            if (mLeft != 0) {
+                --mLeft;
+                next.push(std::move(value));
+            }
+        }
+
+        bool closed() const noexcept {
+            return mLeft == 0;
+        }
+
+        template <class Next>
+        void flush(Next &next) {
+            next.flush();
+        }
+
+        std::size_t mLeft;
+    };
+
+    std::size_t mCount;
+};
+
+struct PipeChunk : PipeStageBase {
+    template <class In>
+    struct Stage {
+        using Output = std::vector<In>;
+
+        explicit Stage(PipeChunk const &pipe) noexcept : mSize(pipe.mSize) {}
+
+        template <class Next>
+        void push(In &&value, Next &next) {
+            if (mChunk.empty()) {
+                mChunk.reserve(mSize);
+            }
+            mChunk.push_back(std::move(value));
+            if (mChunk.size() == mSize) {
+                next.push(std::exchange(mChunk, {}));
+            }
+        }
+
+        bool closed() const noexcept {
+            return false;
+        }
+
+        // 源生成器结束时不足 mSize 个的最后一块也要交出
+        template <class Next>
+        void flush(Next &next) {
+            if (!mChunk.empty()) {
+                next.push(std::exchange(mChunk, {}));
+            }
+            next.flush();
+        }
+
+        std::size_t mSize;
+        std::vector<In> mChunk;
+    };
+
+    std::size_t mSize;
+};
+
+template <class F>
+PipeMap<F> map(F func) {
+    return {{}, std::move(func)};
+}
+
+template <class F>
+PipeFilter<F> filter(F pred) {
+    return {{}, std::move(pred)};
+}
+
+inline PipeTake take(std::size_t count) noexcept {
+    return {{}, count};
+}
+
+inline PipeChunk chunk(std::size_t size) {
+    if (size == 0) [[unlikely]] {
+        throw std::invalid_argument("chunk size must be positive");
+    }
+    return {{}, size};
+}
+
+// 各阶段嵌套成一条链，末端保存最多一个输出：以上阶段每次 push
+// 最多产生一个输出，flush 只在 push 没有输出时才可能产生一个
+template <class In, class... Fs>
+struct PipeChain {
+    using Output = In;
+
+    void push(In &&value) {
+        mOutput.emplace(std::move(value));
+    }
+
+    bool closed() const noexcept {
+        return false;
+    }
+
+    void flush() {}
+
+    std::optional<In> &output() noexcept {
+        return mOutput;
+    }
+
+    std::optional<In> mOutput;
+};
+
+template <class In, class F, class... Fs>
+struct PipeChain<In, F, Fs...> {
+    using StageType = typename F::template Stage<In>;
+    using Next = PipeChain<typename StageType::Output, Fs...>;
+    using Output = typename Next::Output;
+
+    explicit PipeChain(F const &stage, Fs const &...stages)
+        : mStage(stage),
+          mNext(stages...) {}
+
+    void push(In &&value) {
+        mStage.push(std::move(value), mNext);
+    }
+
+    bool closed() const noexcept {
+        return mStage.closed() || mNext.closed();
+    }
+
+    void flush() {
+        mStage.flush(mNext);
+    }
+
+    std::optional<Output> &output() noexcept {
+        return mNext.output();
+    }
+
+    StageType mStage;
+    Next mNext;
+};
+
+// Generator 上的惰性管道。各阶段在源生成器每产出一个值后依次内联调用，
+// 整条管道每个元素只恢复源生成器这一个协程，而不是每个阶段一个。
+// 可以作为 input_range 遍历或交给 std::views (要求源生成器只在 co_yield
+// 处挂起)，也可以 co_await 逐个取出 (源生成器可以在其间等待 I/O)
+template <class T, class P, class... Fs>
+struct GeneratorPipe : private CompletionHook {
+    static_assert(!std::is_reference_v<T>);
+
+    using Chain = PipeChain<T, Fs...>;
+    using Output = typename Chain::Output;
+
+    GeneratorPipe(Generator<T, P> &&source, std::tuple<Fs...> stages)
+        : CompletionHook{&GeneratorPipe::onYield},
+          mSource(std::move(source)),
+          mStages(std::move(stages)),
+          mChain(std::make_from_tuple<Chain>(mStages)) {}
+
+    // 只能在开始取值前移动，如继续用 | 追加阶段
+    GeneratorPipe(GeneratorPipe &&that)
+        : GeneratorPipe(std::move(that.mSource), std::move(that.mStages)) {}
+
+    template <std::derived_from<PipeStageBase> F>
+    friend GeneratorPipe<T, P, Fs..., F> operator|(GeneratorPipe &&pipe,
+                                                  F stage) {
+        return GeneratorPipe<T, P, Fs..., F>(
+            std::move(pipe.mSource),
+            std::tuple_cat(std::move(pipe.mStages),
+                           std::tuple<F>(std::move(stage))));
+    }
+
+    struct Iterator {
+        using value_type = Output;
+        using difference_type = std::ptrdiff_t;
+
+        Output &operator*() const noexcept {
+            return *mPipe->mChain.output();
+        }
+
+        Iterator &operator++() {
+            mPipe->nextSync();
+            return *this;
+        }
+
+        void operator++(int) {
+            ++*this;
+        }
+
+        bool ended() const noexcept {
+            return !mPipe->mChain.output();
+        }
+
+        friend bool operator==(Iterator const &it,
+                               std::default_sentinel_t) noexcept {
+            return it.ended();
+        }
+
+        GeneratorPipe *mPipe{};
+    };
+
+    // 只能遍历一次，begin 即开始运行源生成器
+    Iterator begin() {
+        nextSync();
+        return Iterator{this};
+    }
+
+    std::default_sentinel_t end() const noexcept {
+        return {};
+    }
+
+    // 管道结束后返回 nullopt，源生成器或各阶段抛出的异常在此重新抛出
+    struct Awaiter {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine) {
+            mPipe.mConsumer = coroutine;
+            try {
+                return !mPipe.pull();
+            } catch (...) {
+                mPipe.fail();
+                return false;
+            }
+        }
+
+        std::optional<Output> await_resume() {
+            if (mPipe.mException) [[unlikely]] {
+                std::rethrow_exception(std::exchange(mPipe.mException, {}));
+            }
+            return std::move(mPipe.mChain.output());
+        }
+
+        // 等待者被 when_any 等放弃时，源生成器之后产出的这个值随之丢弃
+        void detach() const noexcept {
+            mPipe.mConsumer = std::noop_coroutine();
+        }
+
+        GeneratorPipe &mPipe;
+    };
+
+    Awaiter operator co_await() noexcept {
+        return Awaiter{*this};
+    }
+
+private:
+    template <class, class, class...>
+    friend struct GeneratorPipe;
+
+    std::coroutine_handle<P> source() const noexcept {
+        return mSource;
+    }
+
+    // 源生成器的当前状态推入管道，返回是否有输出或已结束
+    bool step() {
+        auto &promise = source().promise();
+        if (promise.final()) {
+            finish();
+        } else {
+            mChain.push(promise.result());
+            if (mChain.closed()) {
+                finish();
+            }
+        }
+        return mEnded || mChain.output();
+    }
+
+    void finish() {
+        if (!mEnded) {
+            mEnded = true;
+            mChain.flush();
+        }
+    }
+
+    void fail() noexcept {
+        mException = std::current_exception();
+        mEnded = true;
+        mChain.output().reset();
+    }
+
+    // 反复恢复源生成器直到有输出或结束；源生成器同步产出时经完成回调
+    // 回到这里，等待 I/O 而挂起时返回 false，之后产出时由 onYield 继续
+    bool pull() {
+        mChain.output().reset();
+        if (!source()) {
+            finish();
+        }
+        while (!mEnded) {
+            if (mChain.closed()) {
+                finish();
+                break;
+            }
+            mInside = true;
+            mYielded = false;
+            source().promise().mHook = this;
+            source().resume();
+            mInside = false;
+            if (!mYielded) {
+                return false;
+            }
+            if (step()) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    void nextSync() {
+        if (!pull()) [[unlikely]] {
+            source().promise().mPrevious = std::noop_coroutine();
+            source().promise().mHook = nullptr;
+            throw std::logic_error(
+                "generator suspended outside co_yield during iteration");
+        }
+    }
+
+    // 源生成器每次产出或结束时调用，返回值即接着恢复的协程
+    static std::coroutine_handle<> onYield(CompletionHook &hook) noexcept {
+        auto &self = static_cast<GeneratorPipe &>(hook);
+        if (self.mInside) {
+            self.mYielded = true;
+            return std::noop_coroutine();
+        }
+        try {
+            if (!self.step() && !self.pull()) {
+                return std::noop_coroutine();
+            }
+        } catch (...) {
+            self.fail();
+        }
+        return self.mConsumer;
+    }
+
+    Generator<T, P> mSource;
+    std::tuple<Fs...> mStages;
+    Chain mChain;
+    std::coroutine_handle<> mConsumer{};
+    std::exception_ptr mException{};
+    bool mInside = false;
+    bool mYielded = false;
+    bool mEnded = false;
+};
+
+template <class T, class P, std::derived_from<PipeStageBase> F>
+GeneratorPipe<T, P, F> operator|(Generator<T, P> &&source, F stage) {
+    return GeneratorPipe<T, P, F>(std::move(source),
+                                  std::tuple<F>(std::move(stage)));
+}
+
+} // namespace co_async
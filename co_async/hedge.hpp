@@ -0,0 +1,169 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <co_async/task.hpp>
+#include <co_async/timer_loop.hpp>
+#include <co_async/when_any.hpp>
+#include <co_async/concepts.hpp>
+#include <co_async/non_void_helper.hpp>
+
+namespace co_async {
+
+// 供调整 delay 参考：hedge_rate 过高说明 delay 短于多数请求的耗时，
+// hedge_win_rate 过低说明额外尝试很少能抢先完成
+struct HedgeStats {
+    std::uint64_t mCalls = 0;     // hedge 调用次数
+    std::uint64_t mAttempts = 0;  // 发起的尝试总数
+    std::uint64_t mHedged = 0;    // 等满 delay 后发起了额外尝试的调用次数
+    std::uint64_t mHedgeWins = 0; // 由等满 delay 后发起的尝试胜出的调用次数
+    std::uint64_t mFailures = 0;  // 所有尝试均失败的调用次数
+
+    double hedge_rate() const noexcept {
+        return mCalls ? double(mHedged) / double(mCalls) : 0;
+    }
+
+    double hedge_win_rate() const noexcept {
+        return mHedged ? double(mHedgeWins) / double(mHedged) : 0;
+    }
+};
+
+template <class F, class T>
+struct HedgeState {
+    using RetType = T;
+
+    static constexpr std::size_t kNullIndex = std::size_t(-1);
+
+    TimerLoop &mLoop;
+    F &mFactory;
+    std::chrono::system_clock::duration mDelay;
+    std::size_t mMaxAttempts;
+    std::size_t mNext = 0;
+    std::size_t mPending = 0;
+    std::size_t mWinner = kNullIndex;
+    std::size_t mFirstHedge = kNullIndex;
+    std::exception_ptr mException{};
+
+    void record(HedgeStats &stats) const noexcept {
+        ++stats.mCalls;
+        stats.mAttempts += mNext;
+        if (mFirstHedge != kNullIndex) {
+            ++stats.mHedged;
+            if (mWinner != kNullIndex && mWinner >= mFirstHedge) {
+                ++stats.mHedgeWins;
+            }
+        }
+        if (mWinner == kNullIndex) {
+            ++stats.mFailures;
+        }
+    }
+};
+
+// 永不恢复，仅等待所在的 when_any 分支被销毁
+template <class T>
+struct HedgeAbstain {
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+
+    T await_resume() const noexcept {
+        std::terminate();
+    }
+};
+
+template <class State>
+Task<typename State::RetType> hedgeRace(State &state);
+
+template <class State>
+Task<typename State::RetType> hedgeAttempt(State &state, std::size_t index,
+                                           bool *launched) {
+    using T = typename State::RetType;
+    try {
+        T ret = (co_await state.mFactory(index), NonVoidHelper<>());
+        state.mWinner = index;
+        co_return std::move(ret);
+    } catch (...) {
+        state.mException = std::current_exception();
+    }
+    --state.mPending;
+    if (launched && !*launched) {
+        // 失败时不必等满间隔，立即发起下一次尝试
+        *launched = true;
+        co_return co_await hedgeRace(state);
+    }
+    if (state.mPending == 0 && state.mNext == state.mMaxAttempts) {
+        std::rethrow_exception(state.mException);
+    }
+    co_return co_await HedgeAbstain<T>();
+}
+
+template <class State>
+Task<typename State::RetType> hedgeStagger(State &state, bool *launched) {
+    co_await sleep_for(state.mLoop, state.mDelay);
+    if (*launched) {
+        co_return co_await HedgeAbstain<typename State::RetType>();
+    }
+    *launched = true;
+    if (state.mFirstHedge == State::kNullIndex) {
+        state.mFirstHedge = state.mNext;
+    }
+    co_return co_await hedgeRace(state);
+}
+
+template <class State>
+Task<typename State::RetType> hedgeRace(State &state) {
+    std::size_t index = state.mNext++;
+    ++state.mPending;
+    if (state.mNext == state.mMaxAttempts) {
+        co_return co_await hedgeAttempt(state, index, nullptr);
+    }
+    bool launched = false;
+    auto v = co_await when_any(hedgeAttempt(state, index, &launched),
+                               hedgeStagger(state, &launched));
+    co_return std::visit([](auto &ret) { return std::move(ret); }, v);
+}
+
+// 先发起一次尝试，超过 delay 仍未完成时再发起下一次，至多 maxAttempts 次；
+// 返回最先成功的结果，其余尝试随之取消。factory(i) 返回第 i 次尝试，
+// 可据 i 选择不同副本。全部失败时抛出最后一次失败的异常
+template <class F, class Rep, class Period>
+    requires Awaitable<std::invoke_result_t<F &, std::size_t>>
+Task<typename AwaitableTraits<std::invoke_result_t<F &, std::size_t>>::RetType>
+hedge(TimerLoop &loop, F factory, std::chrono::duration<Rep, Period> delay,
+      std::size_t maxAttempts = 2, HedgeStats *stats = nullptr) {
+    using T = typename AwaitableTraits<
+        std::invoke_result_t<F &, std::size_t>>::RetType;
+    if (maxAttempts == 0) [[unlikely]] {
+        throw std::invalid_argument("hedge needs at least one attempt");
+    }
+    HedgeState<F, typename NonVoidHelper<T>::Type> state{
+        loop, factory,
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            delay),
+        maxAttempts};
+    try {
+        [[maybe_unused]] auto ret = co_await hedgeRace(state);
+        if (stats) {
+            state.record(*stats);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            co_return std::move(ret);
+        }
+    } catch (...) {
+        if (stats) {
+            state.record(*stats);
+        }
+        throw;
+    }
+}
+
+} // namespace co_async
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <co_async/task.hpp>
+#include <co_async/flat_map.hpp>
+#include <co_async/http_header_id.hpp>
+#include <co_async/http_parser.hpp>
+#include <co_async/http_body.hpp>
+
+namespace co_async {
+
+// 键不区分大小写，按插入顺序写出；已知头部另有按编号的下标，
+// 用 HTTPHeaderId 查找时不做字符串比较
+struct HTTPHeaders {
+    using value_type = std::pair<std::string, std::string>;
+
+    HTTPHeaders() = default;
+
+    HTTPHeaders(std::initializer_list<value_type> init) {
+        reserve(init.size());
+        for (auto const &[k, v]: init) {
+            insert_or_assign(k, v);
+        }
+    }
+
+    std::string *at(HTTPHeaderId id) noexcept {
+        return const_cast<std::string *>(std::as_const(*this).at(id));
+    }
+
+    std::string const *at(HTTPHeaderId id) const noexcept {
+        if (id == HTTPHeaderId::Unknown) {
+            return nullptr;
+        }
+        if (auto i = mKnown[std::size_t(id)]) {
+            return &mEntries.begin()[i - 1].second;
+        }
+        return nullptr;
+    }
+
+    std::string *at(std::string_view key) noexcept {
+        return const_cast<std::string *>(std::as_const(*this).at(key));
+    }
+
+    // 已知头部也存放在 mEntries 中，按名字查找时直接比较，不必先算哈希
+    std::string const *at(std::string_view key) const noexcept {
+        return mEntries.at(key);
+    }
+
+    std::string &insert_or_assign(HTTPHeaderId id, std::string value) {
+        return insert_or_assign(id, std::string(http_header_name(id)),
+                                std::move(value));
+    }
+
+    // 只有新插入的键才需要算出编号
+    std::string &insert_or_assign(std::string key, std::string value) {
+        if (auto *v = at(key)) {
+            *v = std::move(value);
+            return *v;
+        }
+        HTTPHeaderId id = http_header_id(key);
+        if (id != HTTPHeaderId::Unknown) {
+            mKnown[std::size_t(id)] = std::uint32_t(mEntries.size() + 1);
+        }
+        return mEntries.emplace_back(std::move(key), std::move(value)).second;
+    }
+
+    // id 须与 key 相符，用于解析器已算出编号的场合
+    std::string &insert_or_assign(HTTPHeaderId id, std::string key,
+                                  std::string value) {
+        if (id == HTTPHeaderId::Unknown) {
+            return mEntries.insert_or_assign(std::move(key), std::move(value));
+        }
+        if (auto *v = at(id)) {
+            *v = std::move(value);
+            return *v;
+        }
+        mKnown[std::size_t(id)] = std::uint32_t(mEntries.size() + 1);
+        return mEntries.emplace_back(std::move(key), std::move(value)).second;
+    }
+
+    // 键已存在时保留原值
+    std::string &insert(std::string key, std::string value) {
+        if (auto *v = at(key)) {
+            return *v;
+        }
+        return insert_or_assign(std::move(key), std::move(value));
+    }
+
+    bool contains(HTTPHeaderId id) const noexcept {
+        return at(id) != nullptr;
+    }
+
+    bool contains(std::string_view key) const noexcept {
+        return at(key) != nullptr;
+    }
+
+    bool erase(std::string_view key) {
+        if (!mEntries.erase(key)) {
+            return false;
+        }
+        // 后面的项已前移，重建编号下标
+        mKnown.fill(0);
+        std::size_t i = 0;
+        for (auto const &[k, v]: mEntries) {
+            ++i;
+            if (auto id = http_header_id(k); id != HTTPHeaderId::Unknown) {
+                mKnown[std::size_t(id)] = std::uint32_t(i);
+            }
+        }
+        return true;
+    }
+
+    void clear() noexcept {
+        mEntries.clear();
+        mKnown.fill(0);
+    }
+
+    void reserve(std::size_t n) {
+        mEntries.reserve(n);
+    }
+
+    std::size_t size() const noexcept {
+        return mEntries.size();
+    }
+
+    bool empty() const noexcept {
+        return mEntries.empty();
+    }
+
+    // 只提供只读遍历，改动键会使 mKnown 失效，改值请经由 at
+    auto begin() const noexcept {
+        return mEntries.begin();
+    }
+
+    auto end() const noexcept {
+        return mEntries.end();
+    }
+
+private:
+    FlatMap<std::string, std::string, 16, HTTPKeyEqual> mEntries;
+    // 已知头部在 mEntries 中的下标加一，0 表示没有；用户构造的头部
+    // 数量不受解析器的上限约束，下标须容得下任意项数
+    std::array<std::uint32_t, kHTTPKnownHeaders> mKnown{};
+};
+
+struct HTTPRequest {
+    std::string method;
+    std::string uri;
+    HTTPHeaders headers;
+    std::string body;
+
+    // 只写起始行与头部，不含结束头部的空行
+    Task<> write_head(auto &sock) const {
+        co_await sock.puts(method);
+        co_await sock.putchar(' ');
+        co_await sock.puts(uri);
+        co_await sock.puts(" HTTP/1.1\r\n");
+        for (auto const &[k, v]: headers) {
+            co_await sock.puts(k);
+            co_await sock.puts(": ");
+            co_await sock.puts(v);
+            co_await sock.puts("\r\n");
+        }
+    }
+
+    Task<> write_into(auto &sock) const {
+        co_await write_head(sock);
+        if (!body.empty()) {
+            co_await sock.puts("content-length: ");
+            co_await sock.puts(std::to_string(body.size()));
+            co_await sock.puts("\r\n");
+        }
+        co_await sock.puts("\r\n");
+        co_await sock.puts(body);
+    }
+
+    // 以分块编码流式发送报文体，写完后调用 finish 并刷新 sock
+    template <class Stream>
+    Task<HTTPChunkedOStream<Stream>> write_chunked(Stream &sock) const {
+        co_await write_head(sock);
+        co_await sock.puts("transfer-encoding: chunked\r\n\r\n");
+        co_return HTTPChunkedOStream<Stream>(sock);
+    }
+
+    auto repr() const {
+        return std::make_tuple(method, uri, headers, body);
+    }
+};
+
+struct HTTPResponse {
+    int status;
+    HTTPHeaders headers;
+    std::string body;
+
+    Task<> read_head(auto &sock) {
+        HTTPParser<> parser(HTTPParser<>::Response);
+        co_await parser.read_from(sock);
+        status = parser.status();
+        headers.clear();
+        headers.reserve(parser.numHeaders());
+        for (auto h: parser) {
+            headers.insert_or_assign(h.id, std::string(h.key),
+                                     std::string(h.value));
+        }
+        // headers 中同名头部只留最后一个，分帧用的头部重复时先在这里校验
+        if (parser.repeated(HTTPHeaderId::TransferEncoding)) [[unlikely]] {
+            throw std::invalid_argument("repeated transfer-encoding");
+        }
+        (void)parser.contentLength();
+    }
+
+    // 按头部确定报文体的分帧方式 (RFC 9112 6.3)，返回的读取器以 0 表示结尾
+    template <class Stream>
+    HTTPBodyReadBuf<Stream> body_reader(Stream &sock) const {
+        using Body = HTTPBodyReadBuf<Stream>;
+        if (status / 100 == 1 || status == 204 || status == 304) {
+            return Body(sock, Body::Length, 0);
+        }
+        if (auto te = headers.at(HTTPHeaderId::TransferEncoding)) {
+            if (http_is_chunked(*te)) [[likely]] {
+                return Body(sock, Body::Chunked);
+            }
+            return Body(sock, Body::UntilClose);
+        }
+        if (auto cl = headers.at(HTTPHeaderId::ContentLength)) {
+            auto len = http_parse_size(*cl);
+            if (!len) [[unlikely]] {
+                throw std::invalid_argument("invalid content-length");
+            }
+            return Body(sock, Body::Length, *len);
+        }
+        return Body(sock, Body::UntilClose);
+    }
+
+    Task<> read_from(auto &sock) {
+        co_await read_head(sock);
+        auto reader = body_reader(sock);
+        body = co_await reader.read_all();
+    }
+
+    auto repr() const {
+        return std::make_tuple(status, headers, body);
+    }
+};
+
+} // namespace co_async
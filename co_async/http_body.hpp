@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <co_async/task.hpp>
+#include <co_async/stream_base.hpp>
+
+namespace co_async {
+
+// transfer-encoding 中最后一项编码为 chunked 时按分块读取 (RFC 9112 6.3)
+inline bool http_is_chunked(std::string_view te) noexcept {
+    if (auto comma = te.rfind(','); comma != te.npos) {
+        te.remove_prefix(comma + 1);
+    }
+    while (!te.empty() && (te.front() == ' ' || te.front() == '\t')) {
+        te.remove_prefix(1);
+    }
+    while (!te.empty() && (te.back() == ' ' || te.back() == '\t')) {
+        te.remove_suffix(1);
+    }
+    std::string_view chunked = "chunked";
+    if (te.size() != chunked.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < te.size(); ++i) {
+        if ((te[i] | 0x20) != chunked[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 从已读完头部的流中读取报文体，读到结尾时 read 返回 0；
+// 可直接调用 read 流式处理，也可包装为 IStream 使用 getline 等
+template <class Stream>
+struct HTTPBodyReadBuf {
+    enum Mode {
+        Length,     // content-length 指定长度
+        Chunked,    // transfer-encoding: chunked
+        UntilClose, // 读到连接关闭为止
+    };
+
+    HTTPBodyReadBuf() noexcept : mStream(nullptr), mMode(Length) {}
+
+    HTTPBodyReadBuf(Stream &sock, Mode mode, std::size_t length = 0) noexcept
+        : mStream(&sock),
+          mMode(mode),
+          mRemaining(mode == Length ? length : 0),
+          mDone(mode == Length && length == 0) {}
+
+    Task<std::size_t> read(std::span<char> buffer) {
+        if (mDone || buffer.empty()) {
+            co_return 0;
+        }
+        if (mMode == Chunked && mRemaining == 0) {
+            co_await nextChunk();
+            if (mDone) {
+                co_return 0;
+            }
+        }
+        if (mMode != UntilClose) {
+            buffer = buffer.subspan(0, std::min(buffer.size(), mRemaining));
+        }
+        std::size_t len;
+        auto avail = mStream->peekBuffer();
+        if (!avail.empty()) {
+            len = std::min(buffer.size(), avail.size());
+            std::memcpy(buffer.data(), avail.data(), len);
+            mStream->consumeBuffer(len);
+        } else {
+            // 流缓冲区已空，直接读入调用者的缓冲区，省去一次复制
+            len = co_await mStream->read(buffer);
+            if (len == 0) {
+                if (mMode != UntilClose) [[unlikely]] {
+                    throw EOFException();
+                }
+                mDone = true;
+                co_return 0;
+            }
+        }
+        if (mMode != UntilClose) {
+            mRemaining -= len;
+            if (mMode == Length && mRemaining == 0) {
+                mDone = true;
+            }
+        }
+        co_return len;
+    }
+
+    // 把剩余的报文体全部读入内存
+    Task<std::string> read_all() {
+        std::string s;
+        while (true) {
+            std::size_t old = s.size();
+            s.resize(old + kReadAllStep);
+            std::size_t len =
+                co_await read(std::span(s.data() + old, kReadAllStep));
+            s.resize(old + len);
+            if (len == 0) {
+                break;
+            }
+        }
+        co_return s;
+    }
+
+    bool done() const noexcept {
+        return mDone;
+    }
+
+private:
+    static constexpr std::size_t kReadAllStep = 16384;
+
+    // 在流缓冲区中找到下一行，返回含行尾的长度，尚未消费
+    Task<std::size_t> peekLine() {
+        while (true) {
+            auto buf = mStream->peekBuffer();
+            if (!buf.empty()) {
+                if (auto *p = static_cast<char *>(
+                        std::memchr(buf.data(), '\n', buf.size()))) {
+                    co_return p - buf.data() + 1;
+                }
+            }
+            bool filled = co_await mStream->fillMore();
+            if (!filled) [[unlikely]] {
+                throw std::invalid_argument("http chunk line too long");
+            }
+        }
+    }
+
+    std::string_view lineView(std::size_t n) noexcept {
+        std::string_view line(mStream->peekBuffer().data(), n - 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        return line;
+    }
+
+    [[noreturn]] static void invalid() {
+        throw std::invalid_argument("invalid http chunk");
+    }
+
+    Task<> nextChunk() {
+        if (mChunkTail) {
+            std::size_t n = co_await peekLine();
+            if (!lineView(n).empty()) [[unlikely]] {
+                invalid();
+            }
+            mStream->consumeBuffer(n);
+            mChunkTail = false;
+        }
+        std::size_t n = co_await peekLine();
+        std::string_view line = lineView(n);
+        // 忽略分块扩展
+        if (auto semi = line.find(';'); semi != line.npos) {
+            line = line.substr(0, semi);
+        }
+        while (!line.empty() && (line.back() == ' ' || line.back() == '\t')) {
+            line.remove_suffix(1);
+        }
+        std::size_t size = 0;
+        auto res =
+            std::from_chars(line.data(), line.data() + line.size(), size, 16);
+        if (line.empty() || res.ec != std::errc() ||
+            res.ptr != line.data() + line.size()) [[unlikely]] {
+            invalid();
+        }
+        mStream->consumeBuffer(n);
+        if (size == 0) {
+            // 跳过 trailer 字段直到空行
+            while (true) {
+                std::size_t n = co_await peekLine();
+                bool last = lineView(n).empty();
+                mStream->consumeBuffer(n);
+                if (last) {
+                    break;
+                }
+            }
+            mDone = true;
+            co_return;
+        }
+        mRemaining = size;
+        mChunkTail = true;
+    }
+
+    Stream *mStream;
+    Mode mMode;
+    std::size_t mRemaining = 0;
+    bool mDone = false;
+    bool mChunkTail = false;
+};
+
+template <class Stream>
+using HTTPBodyIStream = IStream<HTTPBodyReadBuf<Stream>>;
+
+// 每次 write 编码为一个分块写入底层流
+template <class Stream>
+struct HTTPChunkedWriteBuf {
+    HTTPChunkedWriteBuf() noexcept : mStream(nullptr) {}
+
+    explicit HTTPChunkedWriteBuf(Stream &sock) noexcept : mStream(&sock) {}
+
+    Task<std::size_t> write(std::span<char const> buffer) {
+        if (buffer.empty()) [[unlikely]] {
+            co_return 0;
+        }
+        char head[sizeof(std::size_t) * 2 + 2];
+        auto res = std::to_chars(head, head + sizeof(head) - 2, buffer.size(),
+                                 16);
+        res.ptr[0] = '\r';
+        res.ptr[1] = '\n';
+        co_await mStream->puts(std::string_view(head, res.ptr + 2));
+        co_await mStream->puts(
+            std::string_view(buffer.data(), buffer.size()));
+        co_await mStream->puts("\r\n");
+        co_return buffer.size();
+    }
+
+    Task<> writeLastChunk() {
+        co_await mStream->puts("0\r\n\r\n");
+    }
+
+private:
+    Stream *mStream;
+};
+
+// 缓冲区每次刷新成为一个分块；finish 写入结束分块，之后仍需刷新底层流
+template <class Stream>
+struct [[nodiscard]] HTTPChunkedOStream
+    : OStream<HTTPChunkedWriteBuf<Stream>> {
+    using OStream<HTTPChunkedWriteBuf<Stream>>::OStream;
+
+    Task<> finish() {
+        co_await this->flush();
+        co_await this->writeLastChunk();
+    }
+};
+
+} // namespace co_async
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace co_async {
+
+// 常用头部名编号，解析时即转为编号，查找时直接按编号定位
+enum class HTTPHeaderId : std::uint8_t {
+    Accept,
+    AcceptEncoding,
+    AcceptLanguage,
+    AcceptRanges,
+    Age,
+    Allow,
+    Authorization,
+    CacheControl,
+    Connection,
+    ContentDisposition,
+    ContentEncoding,
+    ContentLanguage,
+    ContentLength,
+    ContentLocation,
+    ContentRange,
+    ContentType,
+    Cookie,
+    Date,
+    ETag,
+    Expect,
+    Expires,
+    Forwarded,
+    Host,
+    IfMatch,
+    IfModifiedSince,
+    IfNoneMatch,
+    IfRange,
+    IfUnmodifiedSince,
+    KeepAlive,
+    LastModified,
+    Link,
+    Location,
+    Origin,
+    Pragma,
+    ProxyAuthenticate,
+    ProxyAuthorization,
+    Range,
+    Referer,
+    RetryAfter,
+    SecWebSocketAccept,
+    SecWebSocketKey,
+    SecWebSocketVersion,
+    Server,
+    SetCookie,
+    TE,
+    Trailer,
+    TransferEncoding,
+    Upgrade,
+    UserAgent,
+    Vary,
+    Via,
+    WWWAuthenticate,
+    XForwardedFor,
+    XForwardedProto,
+    XRequestId,
+    Unknown,
+};
+
+// 与 HTTPHeaderId 一一对应，均为小写
+inline constexpr std::string_view kHTTPHeaderNames[] = {
+    "accept",
+    "accept-encoding",
+    "accept-language",
+    "accept-ranges",
+    "age",
+    "allow",
+    "authorization",
+    "cache-control",
+    "connection",
+    "content-disposition",
+    "content-encoding",
+    "content-language",
+    "content-length",
+    "content-location",
+    "content-range",
+    "content-type",
+    "cookie",
+    "date",
+    "etag",
+    "expect",
+    "expires",
+    "forwarded",
+    "host",
+    "if-match",
+    "if-modified-since",
+    "if-none-match",
+    "if-range",
+    "if-unmodified-since",
+    "keep-alive",
+    "last-modified",
+    "link",
+    "location",
+    "origin",
+    "pragma",
+    "proxy-authenticate",
+    "proxy-authorization",
+    "range",
+    "referer",
+    "retry-after",
+    "sec-websocket-accept",
+    "sec-websocket-key",
+    "sec-websocket-version",
+    "server",
+    "set-cookie",
+    "te",
+    "trailer",
+    "transfer-encoding",
+    "upgrade",
+    "user-agent",
+    "vary",
+    "via",
+    "www-authenticate",
+    "x-forwarded-for",
+    "x-forwarded-proto",
+    "x-request-id",
+};
+
+inline constexpr std::size_t kHTTPKnownHeaders = std::size(kHTTPHeaderNames);
+
+static_assert(kHTTPKnownHeaders == std::size_t(HTTPHeaderId::Unknown));
+
+inline constexpr std::string_view http_header_name(HTTPHeaderId id) noexcept {
+    return kHTTPHeaderNames[std::size_t(id)];
+}
+
+// 已知头部名的长度与首、中、尾三个字符已两两不同，只取这几处计算哈希，
+// 不随名字长度逐字符累乘；大小写不敏感
+inline constexpr std::uint32_t httpHeaderHash(std::uint32_t seed,
+                                              std::string_view name) noexcept {
+    auto mix = [&](std::uint32_t c) {
+        seed = (seed ^ c) * 0x01000193u;
+    };
+    std::size_t n = name.size();
+    mix(std::uint32_t(n));
+    mix(static_cast<unsigned char>(name[0] | 0x20));
+    mix(static_cast<unsigned char>(name[n / 2] | 0x20));
+    mix(static_cast<unsigned char>(name[n - 1] | 0x20));
+    return seed;
+}
+
+// 编译期搜索一个种子使所有已知头部名落在互不相同的槽中
+struct HTTPHeaderTable {
+    static constexpr std::uint32_t kSlotBits = 9;
+    static constexpr std::size_t kSlots = std::size_t(1) << kSlotBits;
+
+    std::uint32_t mSeed = 0;
+    std::size_t mMinLength = 0;
+    std::size_t mMaxLength = 0;
+    std::array<HTTPHeaderId, kSlots> mSlots{};
+
+    static constexpr std::size_t slot(std::uint32_t hash) noexcept {
+        return (hash * 0x9e3779b1u) >> (32 - kSlotBits);
+    }
+
+    static consteval HTTPHeaderTable make() {
+        HTTPHeaderTable table;
+        for (std::uint32_t seed = 0x811c9dc5u;; ++seed) {
+            table.mSeed = seed;
+            table.mSlots.fill(HTTPHeaderId::Unknown);
+            bool ok = true;
+            for (std::size_t i = 0; ok && i < kHTTPKnownHeaders; ++i) {
+                auto &s = table.mSlots[slot(
+                    httpHeaderHash(seed, kHTTPHeaderNames[i]))];
+                ok = s == HTTPHeaderId::Unknown;
+                s = HTTPHeaderId(i);
+            }
+            if (ok) {
+                break;
+            }
+        }
+        table.mMinLength = table.mMaxLength = kHTTPHeaderNames[0].size();
+        for (auto name: kHTTPHeaderNames) {
+            table.mMinLength = std::min(table.mMinLength, name.size());
+            table.mMaxLength = std::max(table.mMaxLength, name.size());
+        }
+        return table;
+    }
+
+    // 哈希命中后还需比较一次名字，name 已是小写时只做一次整体比较
+    constexpr HTTPHeaderId lookup(std::string_view name) const noexcept {
+        if (name.size() < mMinLength || name.size() > mMaxLength) {
+            return HTTPHeaderId::Unknown;
+        }
+        HTTPHeaderId id = mSlots[slot(httpHeaderHash(mSeed, name))];
+        if (id == HTTPHeaderId::Unknown) {
+            return id;
+        }
+        std::string_view known = http_header_name(id);
+        if (known.size() != name.size()) {
+            return HTTPHeaderId::Unknown;
+        }
+        if (name == known) [[likely]] {
+            return id;
+        }
+        for (std::size_t i = 0; i < name.size(); ++i) {
+            char c = name[i];
+            if (c >= 'A' && c <= 'Z') {
+                c += 'a' - 'A';
+            }
+            if (c != known[i]) {
+                return HTTPHeaderId::Unknown;
+            }
+        }
+        return id;
+    }
+};
+
+inline constexpr HTTPHeaderTable kHTTPHeaderTable = HTTPHeaderTable::make();
+
+// 不区分大小写，不是已知头部时返回 Unknown
+inline constexpr HTTPHeaderId http_header_id(std::string_view name) noexcept {
+    return kHTTPHeaderTable.lookup(name);
+}
+
+static_assert(http_header_id("content-length") == HTTPHeaderId::ContentLength);
+static_assert(http_header_id("Transfer-Encoding") ==
+              HTTPHeaderId::TransferEncoding);
+static_assert(http_header_id("x-unknown") == HTTPHeaderId::Unknown);
+
+} // namespace co_async
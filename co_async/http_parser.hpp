@@ -0,0 +1,356 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <co_async/task.hpp>
+#include <co_async/simd_scan.hpp>
+#include <co_async/http_header_id.hpp>
+
+namespace co_async {
+
+struct HTTPHeaderView {
+    std::string_view key;
+    std::string_view value;
+    HTTPHeaderId id = HTTPHeaderId::Unknown;
+};
+
+inline std::optional<std::size_t> http_parse_size(std::string_view s) {
+    std::size_t n = 0;
+    auto res = std::from_chars(s.data(), s.data() + s.size(), n);
+    if (res.ec != std::errc() || res.ptr != s.data() + s.size() || s.empty())
+        [[unlikely]] {
+        return std::nullopt;
+    }
+    return n;
+}
+
+// 可恢复的 HTTP/1.x 起始行与头部解析器：直接在流缓冲区上原地解析，
+// 只记录偏移量，缓冲区被整体搬移后仍可从上次中断处继续
+template <std::size_t MaxHeaders = 64>
+struct HTTPParser {
+    static_assert(MaxHeaders < 255);
+
+    enum Kind {
+        Request,
+        Response,
+    };
+
+    explicit HTTPParser(Kind kind = Response,
+                        HTTPTokenizer const &tokenizer =
+                            HTTPTokenizer::best()) noexcept
+        : mKind(kind),
+          mTokenizer(&tokenizer) {}
+
+    void reset() noexcept {
+        mLineBegin = 0;
+        mScanned = 0;
+        mHeadSize = 0;
+        mNumHeaders = 0;
+        mStartLineDone = false;
+        mKnown.fill(0);
+        mRepeated.reset();
+    }
+
+    // data 从报文起始处开始；返回 true 表示头部已完整
+    bool parse(std::span<char> data) {
+        mBase = data.data();
+        while (true) {
+            // 一次扫描同时找到行尾并校验行内没有非法控制字符
+            std::size_t eol =
+                mScanned + mTokenizer->findCtl(data.data() + mScanned,
+                                               data.size() - mScanned);
+            if (eol == data.size() ||
+                (data[eol] == '\r' && eol + 1 == data.size())) {
+                mScanned = eol;
+                if (data.size() - mLineBegin > kMaxLine) [[unlikely]] {
+                    throw std::invalid_argument("http line too long");
+                }
+                return false;
+            }
+            std::size_t next;
+            if (data[eol] == '\n') {
+                next = eol + 1;
+            } else if (data[eol] == '\r' && data[eol + 1] == '\n') {
+                next = eol + 2;
+            } else [[unlikely]] {
+                invalid();
+            }
+            std::size_t begin = mLineBegin, end = eol;
+            mLineBegin = mScanned = next;
+            if (!mStartLineDone) {
+                if (begin == end) {
+                    continue; // 允许起始行前有空行 (RFC 9112 2.2)
+                }
+                parseStartLine(begin, end);
+                mStartLineDone = true;
+            } else if (begin == end) {
+                mHeadSize = mLineBegin;
+                return true;
+            } else {
+                parseHeader(begin, end);
+            }
+        }
+    }
+
+    // 从流中读取并解析头部，完成后头部字节从流中消费掉，但视图仍指向缓冲区，
+    // 直到下一次读取流之前有效
+    template <class Stream>
+    Task<> read_from(Stream &sock) {
+        reset();
+        while (!parse(sock.peekBuffer())) {
+            bool filled = co_await sock.fillMore();
+            if (!filled) [[unlikely]] {
+                throw std::invalid_argument("http header too large");
+            }
+        }
+        sock.consumeBuffer(mHeadSize);
+    }
+
+    std::size_t headSize() const noexcept {
+        return mHeadSize;
+    }
+
+    int status() const noexcept {
+        return mStatus;
+    }
+
+    int versionMinor() const noexcept {
+        return mVersionMinor;
+    }
+
+    std::string_view method() const noexcept {
+        return view(mMethod);
+    }
+
+    std::string_view uri() const noexcept {
+        return view(mUri);
+    }
+
+    std::string_view reason() const noexcept {
+        return view(mReason);
+    }
+
+    std::size_t numHeaders() const noexcept {
+        return mNumHeaders;
+    }
+
+    HTTPHeaderView header(std::size_t i) const noexcept {
+        return {view(mHeaders[i].key), view(mHeaders[i].value),
+                mHeaders[i].id};
+    }
+
+    // 已知头部不做字符串比较，同名头部出现多次时返回第一个
+    std::optional<std::string_view> header(HTTPHeaderId id) const noexcept {
+        if (auto i = mKnown[std::size_t(id)]) {
+            return view(mHeaders[i - 1].value);
+        }
+        return std::nullopt;
+    }
+
+    // key 须为小写，解析时已把头部名原地转为小写
+    std::optional<std::string_view>
+    header(std::string_view key) const noexcept {
+        if (auto id = http_header_id(key); id != HTTPHeaderId::Unknown) {
+            return header(id);
+        }
+        for (std::size_t i = 0; i < mNumHeaders; ++i) {
+            if (view(mHeaders[i].key) == key) {
+                return view(mHeaders[i].value);
+            }
+        }
+        return std::nullopt;
+    }
+
+    // 已知头部是否出现了不止一次
+    bool repeated(HTTPHeaderId id) const noexcept {
+        return mRepeated.test(std::size_t(id));
+    }
+
+    // 出现多次时各个取值必须相同，否则报文边界无法确定 (RFC 9112 6.3)
+    std::optional<std::size_t> contentLength() const {
+        if (auto value = header(HTTPHeaderId::ContentLength)) {
+            auto len = http_parse_size(*value);
+            if (!len) [[unlikely]] {
+                throw std::invalid_argument("invalid content-length");
+            }
+            if (repeated(HTTPHeaderId::ContentLength)) [[unlikely]] {
+                for (std::size_t i = 0; i < mNumHeaders; ++i) {
+                    if (mHeaders[i].id == HTTPHeaderId::ContentLength &&
+                        http_parse_size(view(mHeaders[i].value)) != len) {
+                        throw std::invalid_argument(
+                            "conflicting content-length");
+                    }
+                }
+            }
+            return len;
+        }
+        return std::nullopt;
+    }
+
+    struct iterator {
+        HTTPParser const *mParser;
+        std::size_t mIndex;
+
+        HTTPHeaderView operator*() const noexcept {
+            return mParser->header(mIndex);
+        }
+
+        iterator &operator++() noexcept {
+            ++mIndex;
+            return *this;
+        }
+
+        bool operator!=(iterator const &that) const noexcept {
+            return mIndex != that.mIndex;
+        }
+    };
+
+    iterator begin() const noexcept {
+        return {this, 0};
+    }
+
+    iterator end() const noexcept {
+        return {this, mNumHeaders};
+    }
+
+private:
+    static constexpr std::size_t kNpos = std::size_t(-1);
+    static constexpr std::size_t kMaxLine = 8192;
+
+    struct Slice {
+        std::uint32_t begin = 0;
+        std::uint32_t size = 0;
+    };
+
+    struct HeaderSlice {
+        Slice key;
+        Slice value;
+        HTTPHeaderId id;
+    };
+
+    std::string_view view(Slice s) const noexcept {
+        return {mBase + s.begin, s.size};
+    }
+
+    static Slice slice(std::size_t begin, std::size_t end) noexcept {
+        return {(std::uint32_t)begin, (std::uint32_t)(end - begin)};
+    }
+
+    static bool isSpace(char c) noexcept {
+        return c == ' ' || c == '\t';
+    }
+
+    [[noreturn]] static void invalid() {
+        throw std::invalid_argument("invalid http message");
+    }
+
+    std::size_t parseVersion(std::size_t i, std::size_t end) {
+        std::string_view line(mBase + i, end - i);
+        if (line.size() < 8 || line.substr(0, 7) != "HTTP/1." ||
+            line[7] < '0' || line[7] > '9') [[unlikely]] {
+            invalid();
+        }
+        mVersionMinor = line[7] - '0';
+        return i + 8;
+    }
+
+    void parseStartLine(std::size_t begin, std::size_t end) {
+        if (mKind == Response) {
+            // HTTP/1.x SP SSS SP reason (RFC 9112 §4)，状态码恰好三位
+            std::size_t i = parseVersion(begin, end);
+            if (end - i < 5 || mBase[i] != ' ' || mBase[i + 4] != ' ')
+                [[unlikely]] {
+                invalid();
+            }
+            int status = 0;
+            for (std::size_t j = i + 1; j < i + 4; ++j) {
+                if (mBase[j] < '0' || mBase[j] > '9') [[unlikely]] {
+                    invalid();
+                }
+                status = status * 10 + (mBase[j] - '0');
+            }
+            mStatus = status;
+            mReason = slice(i + 5, end);
+        } else {
+            // METHOD URI HTTP/1.x
+            std::string_view line(mBase + begin, end - begin);
+            auto sp1 = line.find(' ');
+            auto sp2 = line.rfind(' ');
+            if (sp1 == line.npos || sp1 == 0 || sp2 == sp1 + 1 || sp1 == sp2)
+                [[unlikely]] {
+                invalid();
+            }
+            mMethod = slice(begin, begin + sp1);
+            mUri = slice(begin + sp1 + 1, begin + sp2);
+            if (parseVersion(begin + sp2 + 1, end) != end) [[unlikely]] {
+                invalid();
+            }
+        }
+    }
+
+    void parseHeader(std::size_t begin, std::size_t end) {
+        if (mNumHeaders == MaxHeaders) [[unlikely]] {
+            throw std::invalid_argument("too many http headers");
+        }
+        std::size_t colon =
+            begin + mTokenizer->findKeyEnd(mBase + begin, end - begin);
+        // 头部名中不允许空白与控制字符，也就拒绝了续行
+        if (colon == begin || colon == end || mBase[colon] != ':')
+            [[unlikely]] {
+            invalid();
+        }
+        // 原地转小写后查出已知头部的编号
+        for (std::size_t i = begin; i < colon; ++i) {
+            char c = mBase[i];
+            if (c >= 'A' && c <= 'Z') {
+                mBase[i] = c + ('a' - 'A');
+            }
+        }
+        HTTPHeaderId id = kHTTPHeaderTable.lookup(
+            std::string_view(mBase + begin, colon - begin));
+        if (id != HTTPHeaderId::Unknown) {
+            if (!mKnown[std::size_t(id)]) {
+                mKnown[std::size_t(id)] = mNumHeaders + 1;
+            } else {
+                mRepeated.set(std::size_t(id));
+            }
+        }
+        // 行扫描已保证值中没有控制字符
+        std::size_t vbegin = colon + 1, vend = end;
+        while (vbegin < vend && isSpace(mBase[vbegin])) {
+            ++vbegin;
+        }
+        while (vend > vbegin && isSpace(mBase[vend - 1])) {
+            --vend;
+        }
+        mHeaders[mNumHeaders++] = {slice(begin, colon), slice(vbegin, vend),
+                                   id};
+    }
+
+    Kind mKind;
+    HTTPTokenizer const *mTokenizer;
+    char *mBase = nullptr;
+    std::size_t mLineBegin = 0;
+    std::size_t mScanned = 0;
+    std::size_t mHeadSize = 0;
+    bool mStartLineDone = false;
+    int mStatus = 0;
+    int mVersionMinor = 0;
+    Slice mMethod;
+    Slice mUri;
+    Slice mReason;
+    std::size_t mNumHeaders = 0;
+    std::array<HeaderSlice, MaxHeaders> mHeaders;
+    // 已知头部第一次出现的下标加一，0 表示没有
+    std::array<std::uint8_t, kHTTPKnownHeaders> mKnown{};
+    std::bitset<kHTTPKnownHeaders> mRepeated;
+};
+
+} // namespace co_async
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <co_async/task.hpp>
+#include <co_async/http.hpp>
+#include <co_async/wait_queue.hpp>
+
+namespace co_async {
+
+// 在一条连接上流水线地发送请求 (RFC 9112 9.3.2)：多个协程并发调用 request，
+// 请求按调用顺序背靠背写出，响应按同一顺序读回并交给对应的协程
+template <class Stream>
+struct HTTPPipeline {
+    explicit HTTPPipeline(Stream &sock, std::size_t depth = 8) noexcept
+        : mSock(&sock),
+          mDepth(depth) {}
+
+    HTTPPipeline(HTTPPipeline &&) = delete;
+
+    // 已发出请求、尚未读完响应的协程数不超过 depth；
+    // 连接出错后所有等待中和之后的请求都会抛出同一个异常
+    Task<HTTPResponse> request(HTTPRequest const &req) {
+        while (!mException && (mWriting || mInflight >= mDepth)) {
+            // 前一个写者直接交来写入权时 mWriting 保持为 true
+            if (co_await Waiter(*this, mSendWaiters)) {
+                break;
+            }
+        }
+        checkBroken();
+        Ticket ticket(*this);
+        try {
+            mWriting = true;
+            co_await req.write_into(*mSock);
+            ticket.mSeq = mWriteSeq++;
+            mAbandoned.push_back(false);
+            if (mInflight < mDepth && handOff()) {
+                // 后面还有请求要写，写入权连同刷新一起交给它
+                ticket.mState = Ticket::Written;
+            } else {
+                co_await flushWritten();
+                ticket.mState = Ticket::Written;
+            }
+            while (true) {
+                checkBroken();
+                if (!mReading) {
+                    if (mReadSeq >= mFlushedSeq) {
+                        // 要读的响应对应的请求还没刷新出去：写者会刷新；
+                        // 没有写者说明接手者在恢复前被取消，在这里补上
+                        if (!mWriting) {
+                            ticket.mState = Ticket::Writing;
+                            mWriting = true;
+                            co_await flushWritten();
+                            ticket.mState = Ticket::Written;
+                            continue;
+                        }
+                    } else if (mReadSeq == ticket.mSeq) {
+                        break;
+                    } else if (mAbandoned.front()) {
+                        // 前面的请求已被取消，替它把响应读走丢弃
+                        ticket.mState = Ticket::Reading;
+                        co_await readOne();
+                        ticket.mState = Ticket::Written;
+                        continue;
+                    }
+                }
+                co_await Waiter(*this, mRecvWaiters, ticket.mSeq);
+            }
+            ticket.mState = Ticket::Reading;
+            HTTPResponse res = co_await readOne();
+            ticket.mState = Ticket::Done;
+            co_return res;
+        } catch (...) {
+            fail(std::current_exception());
+            throw;
+        }
+    }
+
+    std::size_t inflight() const noexcept {
+        return mInflight;
+    }
+
+    bool broken() const noexcept {
+        return (bool)mException;
+    }
+
+private:
+    // 恢复一律经 ReadyQueue，不在取消请求时执行的析构函数中嵌套进行
+    struct Waiter : WaitQueueNode {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            mCoroutine = coroutine;
+            mList.pushBack(this);
+        }
+
+        // 是否由前一个写者交来了写入权
+        bool await_resume() const noexcept {
+            return mHandOff;
+        }
+
+        explicit Waiter(HTTPPipeline &pipeline, WaitQueue &list,
+                        std::uint64_t seq = 0) noexcept
+            : mPipeline(pipeline),
+              mList(list),
+              mSeq(seq) {}
+
+        Waiter(Waiter &&) = delete;
+
+        ~Waiter() {
+            unlink();
+            if (mReady) [[unlikely]] {
+                mPipeline.passOn(*this);
+            }
+        }
+
+        HTTPPipeline &mPipeline;
+        WaitQueue &mList;
+        std::uint64_t mSeq;
+        bool mHandOff = false;
+    };
+
+    // 跟踪一个请求所处的阶段，协程被取消时据此收拾连接状态
+    struct Ticket {
+        enum State {
+            Writing,
+            Written,
+            Reading,
+            Done,
+        };
+
+        explicit Ticket(HTTPPipeline &pipeline) noexcept : mPipeline(pipeline) {
+            ++mPipeline.mInflight;
+        }
+
+        Ticket(Ticket &&) = delete;
+
+        ~Ticket() {
+            auto &p = mPipeline;
+            --p.mInflight;
+            if (mState == Written) {
+                // 响应还没读，留给后面的请求丢弃
+                p.mAbandoned[mSeq - p.mReadSeq] = true;
+                if (mSeq == p.mReadSeq) {
+                    p.wakeReader();
+                }
+            } else if (mState != Done) {
+                // 写到一半或读到一半，连接上的报文边界已无法恢复
+                p.fail(std::make_exception_ptr(
+                    std::runtime_error("http pipeline broken")));
+            }
+            p.wakeOne(p.mSendWaiters);
+        }
+
+        HTTPPipeline &mPipeline;
+        State mState = Writing;
+        std::uint64_t mSeq = 0;
+    };
+
+    // 由持有写入权的协程调用，刷新后归还写入权
+    Task<> flushWritten() {
+        co_await mSock->flush();
+        mFlushedSeq = mWriteSeq;
+        mWriting = false;
+        wakeOne(mSendWaiters);
+        wakeReader();
+    }
+
+    Task<HTTPResponse> readOne() {
+        mReading = true;
+        HTTPResponse res;
+        co_await res.read_from(*mSock);
+        mReading = false;
+        ++mReadSeq;
+        mAbandoned.pop_front();
+        wakeReader();
+        co_return res;
+    }
+
+    void wakeOne(WaitQueue &list) noexcept {
+        if (WaitQueueNode *node = list.popFront()) {
+            ReadyQueue::current().wake(node);
+        }
+    }
+
+    // 把写入权直接交给队首的写者，没有写者在等时返回 false
+    bool handOff() noexcept {
+        WaitQueueNode *node = mSendWaiters.popFront();
+        if (!node) {
+            return false;
+        }
+        static_cast<Waiter *>(node)->mHandOff = true;
+        ReadyQueue::current().wake(node);
+        return true;
+    }
+
+    // 唤醒轮到读取的协程；队首响应已被放弃时随便唤醒一个来丢弃它
+    void wakeReader() noexcept {
+        if (mAbandoned.empty()) {
+            return;
+        }
+        WaitQueueNode *node = mRecvWaiters.find([&](WaitQueueNode *node) {
+            return mAbandoned.front() ||
+                   static_cast<Waiter *>(node)->mSeq == mReadSeq;
+        });
+        if (node) {
+            node->unlink();
+            ReadyQueue::current().wake(node);
+        }
+    }
+
+    // 被唤醒的等待者在恢复前就被销毁，把这次唤醒转交出去
+    void passOn(Waiter &waiter) noexcept {
+        if (&waiter.mList == &mRecvWaiters) {
+            wakeReader();
+        } else if (!waiter.mHandOff) {
+            wakeOne(mSendWaiters);
+        } else if (mException || mInflight >= mDepth || !handOff()) {
+            // 没有写者接手，已写出的请求由轮到读取的协程补上刷新
+            mWriting = false;
+            wakeOne(mSendWaiters);
+            wakeReader();
+        }
+    }
+
+    void fail(std::exception_ptr e) noexcept {
+        if (mException) {
+            return;
+        }
+        mException = e;
+        while (!mSendWaiters.empty()) {
+            wakeOne(mSendWaiters);
+        }
+        while (!mRecvWaiters.empty()) {
+            wakeOne(mRecvWaiters);
+        }
+    }
+
+    void checkBroken() {
+        if (mException) [[unlikely]] {
+            std::rethrow_exception(mException);
+        }
+    }
+
+    Stream *mSock;
+    std::size_t mDepth;
+    std::size_t mInflight = 0;
+    bool mWriting = false;
+    bool mReading = false;
+    std::uint64_t mWriteSeq = 0;
+    std::uint64_t mReadSeq = 0;
+    // 序号小于它的请求都已刷新出去
+    std::uint64_t mFlushedSeq = 0;
+    // 已写出、尚未读取的响应是否已被放弃，队首对应 mReadSeq
+    std::deque<bool> mAbandoned;
+    std::exception_ptr mException{};
+    WaitQueue mSendWaiters;
+    WaitQueue mRecvWaiters;
+};
+
+} // namespace co_async
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace co_async {
+
+// 路由匹配得到的路径参数，名字指向路由表，值指向请求的 uri
+struct HTTPRouteParams {
+    std::optional<std::string_view> get(std::string_view name) const noexcept {
+        for (auto const &[k, v]: mParams) {
+            if (k == name) {
+                return v;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::size_t size() const noexcept {
+        return mParams.size();
+    }
+
+    auto begin() const noexcept {
+        return mParams.begin();
+    }
+
+    auto end() const noexcept {
+        return mParams.end();
+    }
+
+    void clear() noexcept {
+        mParams.clear();
+    }
+
+    std::vector<std::pair<std::string_view, std::string_view>> mParams;
+};
+
+// 压缩前缀树路由：/users/:id 匹配一段，/static/*path 匹配剩余全部；
+// 同一位置静态路径优先于参数，参数优先于通配
+template <class Handler>
+struct HTTPRouter {
+    struct Match {
+        Handler const *handler;
+        // 路径存在但没有对应方法的处理函数，可据此回复 405
+        std::string_view allow;
+    };
+
+    HTTPRouter() : mRoot(std::make_unique<Node>()) {}
+
+    void route(std::string_view method, std::string_view pattern,
+               Handler handler) {
+        if (pattern.empty() || pattern.front() != '/') [[unlikely]] {
+            throw std::invalid_argument("route pattern must start with /");
+        }
+        Node *node = insert(mRoot.get(), pattern);
+        for (auto &[m, h]: node->mHandlers) {
+            if (m == method) {
+                h = std::move(handler);
+                return;
+            }
+        }
+        node->mHandlers.emplace_back(std::string(method), std::move(handler));
+        if (!node->mAllow.empty()) {
+            node->mAllow += ", ";
+        }
+        node->mAllow += method;
+    }
+
+    // 找不到路径时 handler 与 allow 均为空
+    Match match(std::string_view method, std::string_view path,
+                HTTPRouteParams &params) const {
+        params.clear();
+        Node const *node = find(mRoot.get(), path, params);
+        if (!node) {
+            return {nullptr, {}};
+        }
+        if (auto *h = node->handler(method)) {
+            return {h, node->mAllow};
+        }
+        if (method == "HEAD") {
+            if (auto *h = node->handler("GET")) {
+                return {h, node->mAllow};
+            }
+        }
+        return {nullptr, node->mAllow};
+    }
+
+private:
+    struct Node {
+        std::string mPrefix;
+        // 静态子节点的首字符，与 mChildren 一一对应
+        std::string mIndices;
+        std::vector<std::unique_ptr<Node>> mChildren;
+        std::unique_ptr<Node> mParam;
+        std::unique_ptr<Node> mWildcard;
+        std::string mName;
+        std::vector<std::pair<std::string, Handler>> mHandlers;
+        std::string mAllow;
+
+        Handler const *handler(std::string_view method) const noexcept {
+            for (auto const &[m, h]: mHandlers) {
+                if (m == method) {
+                    return &h;
+                }
+            }
+            return nullptr;
+        }
+
+        bool terminal() const noexcept {
+            return !mHandlers.empty();
+        }
+    };
+
+    static Node *insert(Node *node, std::string_view path) {
+        while (!path.empty()) {
+            if (path.front() == ':' || path.front() == '*') {
+                std::size_t end =
+                    path.front() == ':' ? path.find('/') : path.size();
+                if (end == path.npos) {
+                    end = path.size();
+                }
+                std::string_view name = path.substr(1, end - 1);
+                if (name.empty()) [[unlikely]] {
+                    throw std::invalid_argument("route parameter needs a name");
+                }
+                auto &child =
+                    path.front() == ':' ? node->mParam : node->mWildcard;
+                if (!child) {
+                    child = std::make_unique<Node>();
+                    child->mName = name;
+                } else if (child->mName != name) [[unlikely]] {
+                    throw std::invalid_argument(
+                        "conflicting route parameter name");
+                }
+                node = child.get();
+                path.remove_prefix(end);
+                continue;
+            }
+            std::string_view seg = path.substr(0, path.find_first_of(":*"));
+            std::size_t i = node->mIndices.find(seg.front());
+            if (i == std::string::npos) {
+                auto child = std::make_unique<Node>();
+                child->mPrefix = seg;
+                node->mIndices.push_back(seg.front());
+                node->mChildren.push_back(std::move(child));
+                node = node->mChildren.back().get();
+                path.remove_prefix(seg.size());
+                continue;
+            }
+            Node *child = node->mChildren[i].get();
+            std::size_t common = 0;
+            while (common < seg.size() && common < child->mPrefix.size() &&
+                   seg[common] == child->mPrefix[common]) {
+                ++common;
+            }
+            if (common < child->mPrefix.size()) {
+                // 在公共前缀处把已有节点拆成两段
+                auto mid = std::make_unique<Node>();
+                mid->mPrefix = child->mPrefix.substr(0, common);
+                child->mPrefix.erase(0, common);
+                mid->mIndices.push_back(child->mPrefix.front());
+                mid->mChildren.push_back(std::move(node->mChildren[i]));
+                node->mChildren[i] = std::move(mid);
+                child = node->mChildren[i].get();
+            }
+            node = child;
+            path.remove_prefix(common);
+        }
+        return node;
+    }
+
+    static Node const *find(Node const *node, std::string_view path,
+                            HTTPRouteParams &params) {
+        if (path.empty()) {
+            if (node->terminal()) {
+                return node;
+            }
+            if (node->mWildcard && node->mWildcard->terminal()) {
+                params.mParams.emplace_back(node->mWildcard->mName, path);
+                return node->mWildcard.get();
+            }
+            return nullptr;
+        }
+        if (std::size_t i = node->mIndices.find(path.front());
+            i != std::string::npos) {
+            Node const *child = node->mChildren[i].get();
+            if (path.starts_with(child->mPrefix)) {
+                if (auto *found = find(
+                        child, path.substr(child->mPrefix.size()), params)) {
+                    return found;
+                }
+            }
+        }
+        if (node->mParam) {
+            std::size_t end = path.find('/');
+            if (end == path.npos) {
+                end = path.size();
+            }
+            if (end != 0) {
+                params.mParams.emplace_back(node->mParam->mName,
+                                            path.substr(0, end));
+                if (auto *found =
+                        find(node->mParam.get(), path.substr(end), params)) {
+                    return found;
+                }
+                params.mParams.pop_back();
+            }
+        }
+        if (node->mWildcard && node->mWildcard->terminal()) {
+            params.mParams.emplace_back(node->mWildcard->mName, path);
+            return node->mWildcard.get();
+        }
+        return nullptr;
+    }
+
+    std::unique_ptr<Node> mRoot;
+};
+
+} // namespace co_async
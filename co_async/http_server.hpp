@@ -0,0 +1,420 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <sys/uio.h>
+#include <co_async/task.hpp>
+#include <co_async/async_loop.hpp>
+#include <co_async/limit_timeout.hpp>
+#include <co_async/socket.hpp>
+#include <co_async/stream.hpp>
+#include <co_async/tcp_server.hpp>
+#include <co_async/http.hpp>
+#include <co_async/http_router.hpp>
+
+namespace co_async {
+
+inline std::string_view http_status_reason(int status) noexcept {
+    switch (status) {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 408: return "Request Timeout";
+    case 413: return "Content Too Large";
+    case 416: return "Range Not Satisfiable";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+    }
+}
+
+// 逗号分隔的头部值中是否含有 token，不区分大小写
+inline bool httpHasToken(std::string_view list, std::string_view token) {
+    while (!list.empty()) {
+        std::size_t comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        list.remove_prefix(comma == list.npos ? list.size() : comma + 1);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+            item.remove_prefix(1);
+        }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+            item.remove_suffix(1);
+        }
+        if (item.size() == token.size() &&
+            std::equal(item.begin(), item.end(), token.begin(),
+                       [](char a, char b) { return (a | 0x20) == b; })) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 以原因短语为正文的简单响应，用于错误页
+inline HTTPResponse http_status_response(int status) {
+    HTTPResponse res;
+    res.status = status;
+    res.headers.insert_or_assign(HTTPHeaderId::ContentType, "text/plain");
+    res.body = http_status_reason(status);
+    res.body += '\n';
+    return res;
+}
+
+// 处理函数通过它直接写出响应，每个请求恰好写一次；
+// 预先格式化的头部与 sendfile 都绕过 HTTPResponse
+struct HTTPResponseWriter {
+    HTTPResponseWriter(EpollLoop &loop, FileStream &sock) noexcept
+        : mLoop(loop),
+          mSock(sock) {}
+
+    HTTPResponseWriter(HTTPResponseWriter &&) = delete;
+
+    Task<> write_response(HTTPResponse const &res) {
+        auto const *conn = res.headers.at(HTTPHeaderId::Connection);
+        if (conn && httpHasToken(*conn, "close")) {
+            mKeepAlive = false;
+        }
+        char num[24];
+        mHead.clear();
+        mHead += "HTTP/1.1 ";
+        mHead.append(num,
+                     std::to_chars(num, num + sizeof(num), res.status).ptr);
+        mHead += ' ';
+        mHead += http_status_reason(res.status);
+        mHead += "\r\n";
+        auto const *length = res.headers.at(HTTPHeaderId::ContentLength);
+        for (auto const &[k, v]: res.headers) {
+            // 这两项由此处生成
+            if (&v == length || &v == conn) {
+                continue;
+            }
+            mHead += k;
+            mHead += ": ";
+            mHead += v;
+            mHead += "\r\n";
+        }
+        bool noBody =
+            res.status / 100 == 1 || res.status == 204 || res.status == 304;
+        std::string_view body;
+        if (!noBody) {
+            mHead += "content-length: ";
+            mHead.append(num, std::to_chars(num, num + sizeof(num),
+                                            res.body.size())
+                                  .ptr);
+            mHead += "\r\n";
+            body = res.body;
+        }
+        co_await write_preformatted(mHead, body);
+    }
+
+    Task<> write_status(int status) {
+        HTTPResponse res = http_status_response(status);
+        co_await write_response(res);
+    }
+
+    // head 为状态行和各头部行，不含结尾空行，由此补上 connection 与空行；
+    // content-length 须已包含在 head 中。HTTP/1.0 默认不保持连接，
+    // 保持时须明确回复 keep-alive
+    Task<> write_preformatted(std::string_view head, std::string_view body) {
+        mWritten = true;
+        std::string_view tail = !mKeepAlive ? "connection: close\r\n\r\n"
+                                : mHttp10   ? "connection: keep-alive\r\n\r\n"
+                                            : "\r\n";
+        struct iovec iov[3];
+        iov[0].iov_base = const_cast<char *>(head.data());
+        iov[0].iov_len = head.size();
+        iov[1].iov_base = const_cast<char *>(tail.data());
+        iov[1].iov_len = tail.size();
+        iov[2].iov_base = const_cast<char *>(body.data());
+        iov[2].iov_len = mHeadOnly ? 0 : body.size();
+        co_await socket_writev(mLoop, mSock.mFile, iov);
+    }
+
+    // 头部写出后用 sendfile 发送文件内容，不经过用户态
+    Task<> write_file(std::string_view head, AsyncFile &file, off_t offset,
+                      std::size_t length) {
+        co_await write_preformatted(head, std::string_view());
+        if (!mHeadOnly) {
+            co_await socket_sendfile(mLoop, mSock.mFile, file, offset, length);
+        }
+    }
+
+    // 本响应之后关闭连接
+    void close() noexcept {
+        mKeepAlive = false;
+    }
+
+    bool keep_alive() const noexcept {
+        return mKeepAlive;
+    }
+
+    bool head_only() const noexcept {
+        return mHeadOnly;
+    }
+
+    bool written() const noexcept {
+        return mWritten;
+    }
+
+    void reset(bool keepAlive, bool headOnly, bool http10 = false) noexcept {
+        mKeepAlive = keepAlive;
+        mHeadOnly = headOnly;
+        mHttp10 = http10;
+        mWritten = false;
+    }
+
+private:
+    EpollLoop &mLoop;
+    FileStream &mSock;
+    std::string mHead;
+    bool mKeepAlive = true;
+    bool mHeadOnly = false;
+    bool mHttp10 = false;
+    bool mWritten = false;
+};
+
+struct HTTPServerOptions {
+    // keep-alive 连接上等待下一个请求的最长时间，以及读取报文体时每次读的上限
+    std::chrono::system_clock::duration mIdleTimeout =
+        std::chrono::seconds(30);
+    // 从收到请求的第一个字节到读完整个头部的最长时间
+    std::chrono::system_clock::duration mHeaderTimeout =
+        std::chrono::seconds(10);
+    std::size_t mMaxBodySize = 8 * 1024 * 1024;
+};
+
+// HTTP/1.1 服务器：持久连接、空闲与读头部超时、前缀树路由，
+// 响应头与响应体用一次 sendmsg 分散写出。sendmsg 带 MSG_NOSIGNAL，
+// 但 sendfile (HTTPResponseWriter::write_file、HTTPStaticFiles) 不能，
+// 用到它的应用须在启动时 signal(SIGPIPE, SIG_IGN)，本库不修改信号处理
+struct HTTPServer {
+    using Handler = std::function<Task<HTTPResponse>(HTTPRequest &,
+                                                     HTTPRouteParams const &)>;
+    using WriterHandler = std::function<Task<>(
+        HTTPResponseWriter &, HTTPRequest &, HTTPRouteParams const &)>;
+
+    explicit HTTPServer(AsyncLoop &loop, HTTPServerOptions options = {})
+        : mLoop(loop),
+          mOptions(options) {}
+
+    HTTPServer &operator=(HTTPServer &&) = delete;
+
+    void route(std::string_view method, std::string_view pattern,
+               Handler handler) {
+        mRouter.route(
+            method, pattern,
+            [handler = std::move(handler)](HTTPResponseWriter &writer,
+                                           HTTPRequest &req,
+                                           HTTPRouteParams const &params) {
+                return callHandler(handler, writer, req, params);
+            });
+    }
+
+    // 自行通过 HTTPResponseWriter 写出响应的处理函数
+    void route(std::string_view method, std::string_view pattern,
+               WriterHandler handler) {
+        mRouter.route(method, pattern, std::move(handler));
+    }
+
+    Task<> serve(TcpServer &server) {
+        co_await server.serve(
+            [this](FileStream &sock, SocketAddress const &addr) {
+                return handle_connection(sock, addr);
+            });
+    }
+
+    // 处理一条连接上的所有请求，可直接作为 TcpServer::serve 的 handler
+    Task<> handle_connection(FileStream &sock, SocketAddress const &) {
+        HTTPParser<> parser(HTTPParser<>::Request);
+        HTTPRequest req;
+        HTTPRouteParams params;
+        HTTPResponseWriter writer(mLoop, sock);
+        bool keepAlive = true;
+        while (keepAlive) {
+            if (sock.peekBuffer().empty()) {
+                auto ready = co_await limit_timeout(mLoop, sock.fillMore(),
+                                                    mOptions.mIdleTimeout);
+                if (!ready) {
+                    co_return; // 空闲超时，直接关闭
+                }
+            }
+            int status = co_await readHead(sock, parser);
+            if (status == 0) {
+                status = co_await readRequest(sock, parser, req, keepAlive);
+            }
+            if (status != 0) [[unlikely]] {
+                // 请求边界已不可靠，回复错误后关闭连接
+                writer.reset(false, false);
+                co_await writer.write_status(status);
+                co_return;
+            }
+            writer.reset(keepAlive, req.method == "HEAD",
+                         parser.versionMinor() == 0);
+            auto match = mRouter.match(req.method, pathOf(req.uri), params);
+            if (match.handler) [[likely]] {
+                try {
+                    co_await (*match.handler)(writer, req, params);
+                } catch (std::exception const &) {
+                    if (writer.written()) {
+                        throw; // 响应已写出一部分，只能断开
+                    }
+                }
+                if (!writer.written()) [[unlikely]] {
+                    co_await writer.write_status(500);
+                }
+            } else if (!match.allow.empty()) {
+                HTTPResponse res = http_status_response(405);
+                res.headers.insert_or_assign(HTTPHeaderId::Allow,
+                                             std::string(match.allow));
+                co_await writer.write_response(res);
+            } else {
+                co_await writer.write_status(404);
+            }
+            keepAlive = writer.keep_alive();
+        }
+    }
+
+private:
+    static std::string_view pathOf(std::string_view uri) noexcept {
+        return uri.substr(0, uri.find('?'));
+    }
+
+    static Task<> callHandler(Handler const &handler,
+                              HTTPResponseWriter &writer, HTTPRequest &req,
+                              HTTPRouteParams const &params) {
+        HTTPResponse res = co_await handler(req, params);
+        co_await writer.write_response(res);
+    }
+
+    // 返回 0 表示头部已完整，否则为应回复的错误状态码
+    Task<int> readHead(FileStream &sock, HTTPParser<> &parser) {
+        auto deadline =
+            std::chrono::system_clock::now() + mOptions.mHeaderTimeout;
+        parser.reset();
+        try {
+            while (!parser.parse(sock.peekBuffer())) {
+                auto filled =
+                    co_await limit_timeout(mLoop, sock.fillMore(), deadline);
+                if (!filled) {
+                    co_return 408;
+                }
+                if (!*filled) {
+                    co_return 431;
+                }
+            }
+        } catch (std::invalid_argument const &) {
+            co_return 400;
+        }
+        co_return 0;
+    }
+
+    Task<int> readRequest(FileStream &sock, HTTPParser<> &parser,
+                          HTTPRequest &req, bool &keepAlive) {
+        using Body = HTTPBodyReadBuf<FileStream>;
+        req.method = parser.method();
+        req.uri = parser.uri();
+        req.headers.clear();
+        req.headers.reserve(parser.numHeaders());
+        req.body.clear();
+        for (auto h: parser) {
+            req.headers.insert_or_assign(h.id, std::string(h.key),
+                                         std::string(h.value));
+        }
+        auto conn = parser.header(HTTPHeaderId::Connection);
+        if (parser.versionMinor() >= 1) {
+            keepAlive = !(conn && httpHasToken(*conn, "close"));
+        } else {
+            keepAlive = conn && httpHasToken(*conn, "keep-alive");
+        }
+        // 解析结果指向流缓冲区，继续读取之前先确定报文体的分帧方式
+        Body reader;
+        if (auto te = parser.header(HTTPHeaderId::TransferEncoding)) {
+            // 重复的 transfer-encoding 各方合并方式不一，一律拒绝
+            if (parser.repeated(HTTPHeaderId::TransferEncoding) ||
+                !http_is_chunked(*te)) [[unlikely]] {
+                co_return 400;
+            }
+            if (parser.header(HTTPHeaderId::ContentLength)) [[unlikely]] {
+                keepAlive = false; // RFC 9112 6.3，防止请求走私
+            }
+            reader = Body(sock, Body::Chunked);
+        } else {
+            std::optional<std::size_t> len;
+            try {
+                len = parser.contentLength();
+            } catch (std::invalid_argument const &) {
+                co_return 400;
+            }
+            if (!len || *len == 0) {
+                sock.consumeBuffer(parser.headSize());
+                co_return 0;
+            }
+            if (*len > mOptions.mMaxBodySize) [[unlikely]] {
+                co_return 413;
+            }
+            reader = Body(sock, Body::Length, *len);
+        }
+        auto expect = parser.header(HTTPHeaderId::Expect);
+        bool sendContinue = expect && httpHasToken(*expect, "100-continue");
+        sock.consumeBuffer(parser.headSize());
+        if (sendContinue) {
+            std::string_view cont = "HTTP/1.1 100 Continue\r\n\r\n";
+            struct iovec iov[1];
+            iov[0].iov_base = const_cast<char *>(cont.data());
+            iov[0].iov_len = cont.size();
+            co_await socket_writev(mLoop, sock.mFile, iov);
+        }
+        try {
+            while (true) {
+                std::size_t old = req.body.size();
+                std::size_t step =
+                    std::min(kBodyStep, mOptions.mMaxBodySize + 1 - old);
+                req.body.resize(old + step);
+                auto len = co_await limit_timeout(
+                    mLoop, reader.read(std::span(req.body.data() + old, step)),
+                    mOptions.mIdleTimeout);
+                req.body.resize(old + (len ? *len : 0));
+                if (!len) {
+                    co_return 408;
+                }
+                if (*len == 0) {
+                    break;
+                }
+                if (req.body.size() > mOptions.mMaxBodySize) [[unlikely]] {
+                    co_return 413;
+                }
+            }
+        } catch (std::invalid_argument const &) {
+            co_return 400;
+        }
+        co_return 0;
+    }
+
+    static constexpr std::size_t kBodyStep = 16384;
+
+    AsyncLoop &mLoop;
+    HTTPServerOptions mOptions;
+    HTTPRouter<WriterHandler> mRouter;
+};
+
+} // namespace co_async
@@ -0,0 +1,429 @@
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <sys/stat.h>
+#include <co_async/task.hpp>
+#include <co_async/epoll_loop.hpp>
+#include <co_async/filesystem.hpp>
+#include <co_async/http.hpp>
+#include <co_async/http_router.hpp>
+#include <co_async/http_server.hpp>
+
+namespace co_async {
+
+inline std::string_view http_mime_type(std::string_view path) noexcept {
+    static constexpr std::pair<std::string_view, std::string_view> kTypes[] = {
+        {".html", "text/html; charset=utf-8"},
+        {".htm", "text/html; charset=utf-8"},
+        {".css", "text/css; charset=utf-8"},
+        {".js", "text/javascript; charset=utf-8"},
+        {".mjs", "text/javascript; charset=utf-8"},
+        {".json", "application/json"},
+        {".txt", "text/plain; charset=utf-8"},
+        {".xml", "application/xml"},
+        {".svg", "image/svg+xml"},
+        {".png", "image/png"},
+        {".jpg", "image/jpeg"},
+        {".jpeg", "image/jpeg"},
+        {".gif", "image/gif"},
+        {".webp", "image/webp"},
+        {".ico", "image/x-icon"},
+        {".woff", "font/woff"},
+        {".woff2", "font/woff2"},
+        {".wasm", "application/wasm"},
+        {".pdf", "application/pdf"},
+    };
+    auto dot = path.rfind('.');
+    if (dot != path.npos && path.find('/', dot) == path.npos) {
+        std::string_view ext = path.substr(dot);
+        for (auto const &[e, type]: kTypes) {
+            if (ext.size() == e.size() &&
+                std::equal(ext.begin(), ext.end(), e.begin(),
+                           [](char a, char b) { return (a | 0x20) == b; })) {
+                return type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+// IMF-fixdate 格式 (RFC 9110 5.6.7)，如 Sun, 06 Nov 1994 08:49:37 GMT
+inline std::string http_format_date(std::time_t t) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char buf[32];
+    std::size_t n =
+        std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(buf, n);
+}
+
+inline std::optional<std::time_t> http_parse_date(std::string_view s) {
+    char buf[32];
+    if (s.size() >= sizeof(buf)) {
+        return std::nullopt;
+    }
+    s.copy(buf, s.size());
+    buf[s.size()] = '\0';
+    struct tm tm {};
+    char const *end = strptime(buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (!end || *end) {
+        return std::nullopt;
+    }
+    return timegm(&tm);
+}
+
+struct HTTPStaticOptions {
+    // 缓存的总字节数上限，超出时淘汰最久未用的文件
+    std::size_t mMaxCacheBytes = 32 * 1024 * 1024;
+    // 大于此大小的文件不缓存，每次用 sendfile 发送
+    std::size_t mMaxCachedFileSize = 256 * 1024;
+    // 缓存项在此间隔内直接使用，过期后 stat 一次检查是否被修改
+    std::chrono::steady_clock::duration mRevalidateInterval =
+        std::chrono::seconds(1);
+    std::string mIndexFile = "index.html";
+    // 非空时附加为 cache-control 头部
+    std::string mCacheControl;
+};
+
+// 静态文件处理函数：小文件连同格式化好的响应头缓存在内存中 (LRU)，
+// 大文件用 sendfile 发送；支持 If-None-Match 与 If-Modified-Since。
+// sendfile 写入已关闭的连接会触发 SIGPIPE，应用须自行忽略该信号。
+// 用法：server.route("GET", "/static/*path", std::ref(files))
+struct HTTPStaticFiles {
+    explicit HTTPStaticFiles(EpollLoop &loop, std::filesystem::path root,
+                             HTTPStaticOptions options = {})
+        : mLoop(loop),
+          mRoot(std::move(root)),
+          mOptions(std::move(options)) {}
+
+    HTTPStaticFiles(HTTPStaticFiles &&) = delete;
+
+    // 文件路径取自最后一个路由参数，没有参数时取整个请求路径
+    Task<> operator()(HTTPResponseWriter &writer, HTTPRequest &req,
+                      HTTPRouteParams const &params) {
+        std::string_view path = req.uri;
+        path = path.substr(0, path.find('?'));
+        if (params.size() != 0) {
+            path = (params.end() - 1)->second;
+        }
+        auto rel = safePath(path);
+        if (!rel) [[unlikely]] {
+            co_await writer.write_status(404);
+            co_return;
+        }
+        if (auto entry = lookup(*rel)) {
+            co_await sendEntry(writer, req, *entry);
+            co_return;
+        }
+        std::filesystem::path full = mRoot / *rel;
+        AsyncFile file;
+        struct stat st;
+        int status = 0;
+        try {
+            file = co_await open_fs_file(mLoop, full, OpenMode::Read);
+            checkError(fstat(file.fileNo(), &st));
+            if (S_ISDIR(st.st_mode)) {
+                full /= mOptions.mIndexFile;
+                file = co_await open_fs_file(mLoop, full, OpenMode::Read);
+                checkError(fstat(file.fileNo(), &st));
+            }
+            if (!S_ISREG(st.st_mode)) {
+                status = 404;
+            }
+        } catch (std::system_error const &e) {
+            status = e.code() == std::errc::permission_denied ? 403 : 404;
+        }
+        if (status != 0) {
+            co_await writer.write_status(status);
+            co_return;
+        }
+        if (static_cast<std::size_t>(st.st_size) <=
+            mOptions.mMaxCachedFileSize) {
+            auto entry = co_await load(std::move(*rel), std::move(full),
+                                       FsFileBuf(std::move(file)), st);
+            co_await sendEntry(writer, req, *entry);
+            co_return;
+        }
+        std::string etag = makeETag(st);
+        std::string lastModified = http_format_date(st.st_mtime);
+        if (notModified(req, etag, lastModified, st.st_mtime)) {
+            co_await writer.write_preformatted(
+                makeHead(304, full.native(), st.st_size, etag, lastModified),
+                std::string_view());
+            co_return;
+        }
+        co_await writer.write_file(
+            makeHead(200, full.native(), st.st_size, etag, lastModified), file,
+            0, st.st_size);
+    }
+
+    std::size_t cached_bytes() const noexcept {
+        return mCachedBytes;
+    }
+
+    std::size_t cached_files() const noexcept {
+        return mLru.size();
+    }
+
+private:
+    struct Entry {
+        std::string mKey;
+        std::filesystem::path mPath;
+        std::string mHead;
+        std::string mNotModifiedHead;
+        std::string mBody;
+        std::string mETag;
+        std::string mLastModified;
+        std::time_t mMtime;
+        struct timespec mMtim;
+        ino_t mIno;
+        off_t mSize;
+        std::chrono::steady_clock::time_point mChecked;
+
+        std::size_t bytes() const noexcept {
+            return mBody.size() + mHead.size() + mNotModifiedHead.size();
+        }
+    };
+
+    // 发送期间缓存项可能被其他协程淘汰，由 shared_ptr 保持其存活
+    using Iterator = std::list<std::shared_ptr<Entry>>::iterator;
+
+    // 解码 %XX 并规范化，拒绝含 .. 或 NUL 的路径，返回相对于根目录的路径
+    static std::optional<std::string> safePath(std::string_view path) {
+        std::string out;
+        std::string seg;
+        auto flush = [&] {
+            if (seg == "..") {
+                return false;
+            }
+            if (!seg.empty() && seg != ".") {
+                if (!out.empty()) {
+                    out += '/';
+                }
+                out += seg;
+            }
+            seg.clear();
+            return true;
+        };
+        for (std::size_t i = 0; i < path.size(); ++i) {
+            char c = path[i];
+            if (c == '%') {
+                unsigned char v;
+                if (i + 2 >= path.size()) {
+                    return std::nullopt;
+                }
+                auto res =
+                    std::from_chars(path.data() + i + 1, path.data() + i + 3,
+                                    v, 16);
+                if (res.ptr != path.data() + i + 3) {
+                    return std::nullopt;
+                }
+                c = static_cast<char>(v);
+                i += 2;
+            }
+            if (c == '\0') {
+                return std::nullopt;
+            }
+            if (c == '/') {
+                if (!flush()) {
+                    return std::nullopt;
+                }
+            } else {
+                seg += c;
+            }
+        }
+        if (!flush()) {
+            return std::nullopt;
+        }
+        return out;
+    }
+
+    static std::string makeETag(struct stat const &st) {
+        char buf[48];
+        char *p = buf;
+        *p++ = '"';
+        p = std::to_chars(p, buf + sizeof(buf), st.st_mtime, 16).ptr;
+        *p++ = '-';
+        p = std::to_chars(p, buf + sizeof(buf), st.st_size, 16).ptr;
+        *p++ = '"';
+        return std::string(buf, p);
+    }
+
+    std::string makeHead(int status, std::string_view path, off_t size,
+                         std::string_view etag,
+                         std::string_view lastModified) const {
+        std::string head = "HTTP/1.1 ";
+        char num[24];
+        head.append(num, std::to_chars(num, num + sizeof(num), status).ptr);
+        head += ' ';
+        head += http_status_reason(status);
+        head += "\r\n";
+        if (status == 200) {
+            head += "content-type: ";
+            head += http_mime_type(path);
+            head += "\r\ncontent-length: ";
+            head.append(num, std::to_chars(num, num + sizeof(num), size).ptr);
+            head += "\r\n";
+        }
+        head += "etag: ";
+        head += etag;
+        head += "\r\nlast-modified: ";
+        head += lastModified;
+        head += "\r\n";
+        if (!mOptions.mCacheControl.empty()) {
+            head += "cache-control: ";
+            head += mOptions.mCacheControl;
+            head += "\r\n";
+        }
+        return head;
+    }
+
+    static bool etagMatches(std::string_view list, std::string_view etag) {
+        while (!list.empty()) {
+            std::size_t comma = list.find(',');
+            std::string_view item = list.substr(0, comma);
+            list.remove_prefix(comma == list.npos ? list.size() : comma + 1);
+            while (!item.empty() &&
+                   (item.front() == ' ' || item.front() == '\t')) {
+                item.remove_prefix(1);
+            }
+            while (!item.empty() &&
+                   (item.back() == ' ' || item.back() == '\t')) {
+                item.remove_suffix(1);
+            }
+            // If-None-Match 使用弱比较 (RFC 9110 13.1.2)
+            if (item.starts_with("W/")) {
+                item.remove_prefix(2);
+            }
+            if (item == "*" || item == etag) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool notModified(HTTPRequest &req, std::string_view etag,
+                            std::string_view lastModified, std::time_t mtime) {
+        // 有 If-None-Match 时忽略 If-Modified-Since (RFC 9110 13.1.3)
+        if (auto inm = req.headers.at(HTTPHeaderId::IfNoneMatch)) {
+            return etagMatches(*inm, etag);
+        }
+        if (auto ims = req.headers.at(HTTPHeaderId::IfModifiedSince)) {
+            if (*ims == lastModified) {
+                return true;
+            }
+            auto t = http_parse_date(*ims);
+            return t && mtime <= *t;
+        }
+        return false;
+    }
+
+    Task<> sendEntry(HTTPResponseWriter &writer, HTTPRequest &req,
+                     Entry const &entry) {
+        if (notModified(req, entry.mETag, entry.mLastModified,
+                        entry.mMtime)) {
+            co_await writer.write_preformatted(entry.mNotModifiedHead,
+                                               std::string_view());
+        } else {
+            co_await writer.write_preformatted(entry.mHead, entry.mBody);
+        }
+    }
+
+    static bool sameFile(Entry const &entry, struct stat const &st) noexcept {
+        return entry.mIno == st.st_ino && entry.mSize == st.st_size &&
+               entry.mMtim.tv_sec == st.st_mtim.tv_sec &&
+               entry.mMtim.tv_nsec == st.st_mtim.tv_nsec;
+    }
+
+    // 命中且未过期的缓存项，顺带移到 LRU 队首
+    std::shared_ptr<Entry> lookup(std::string const &key) {
+        auto it = mIndex.find(key);
+        if (it == mIndex.end()) {
+            return nullptr;
+        }
+        Iterator pos = it->second;
+        Entry &entry = **pos;
+        auto now = std::chrono::steady_clock::now();
+        if (now - entry.mChecked >= mOptions.mRevalidateInterval) {
+            struct stat st;
+            if (stat(entry.mPath.c_str(), &st) == -1 || !sameFile(entry, st)) {
+                erase(pos);
+                return nullptr;
+            }
+            entry.mChecked = now;
+        }
+        mLru.splice(mLru.begin(), mLru, pos);
+        return *pos;
+    }
+
+    Task<std::shared_ptr<Entry>> load(std::string key, std::filesystem::path path,
+                       FsFileBuf file, struct stat const &st) {
+        std::string body;
+        body.resize(st.st_size);
+        std::size_t n = 0;
+        while (n < body.size()) {
+            std::size_t len = co_await file.read(
+                std::span(body.data() + n, body.size() - n));
+            if (len == 0) {
+                break; // 读取期间文件被截断
+            }
+            n += len;
+        }
+        body.resize(n);
+        auto ptr = std::make_shared<Entry>();
+        Entry &entry = *ptr;
+        entry.mETag = makeETag(st);
+        entry.mLastModified = http_format_date(st.st_mtime);
+        entry.mHead = makeHead(200, path.native(), body.size(), entry.mETag,
+                               entry.mLastModified);
+        entry.mNotModifiedHead = makeHead(304, path.native(), 0, entry.mETag,
+                                          entry.mLastModified);
+        entry.mKey = std::move(key);
+        entry.mPath = std::move(path);
+        entry.mBody = std::move(body);
+        entry.mMtime = st.st_mtime;
+        entry.mMtim = st.st_mtim;
+        entry.mIno = st.st_ino;
+        entry.mSize = st.st_size;
+        entry.mChecked = std::chrono::steady_clock::now();
+        // 并发未命中时可能已由另一个协程载入
+        if (auto it = mIndex.find(entry.mKey); it != mIndex.end()) {
+            erase(it->second);
+        }
+        mLru.push_front(ptr);
+        mCachedBytes += entry.bytes();
+        mIndex.emplace(entry.mKey, mLru.begin());
+        while (mCachedBytes > mOptions.mMaxCacheBytes && mLru.size() > 1) {
+            erase(std::prev(mLru.end()));
+        }
+        co_return ptr;
+    }
+
+    void erase(Iterator pos) {
+        mCachedBytes -= (*pos)->bytes();
+        mIndex.erase((*pos)->mKey);
+        mLru.erase(pos);
+    }
+
+    EpollLoop &mLoop;
+    std::filesystem::path mRoot;
+    HTTPStaticOptions mOptions;
+    std::list<std::shared_ptr<Entry>> mLru;
+    std::unordered_map<std::string_view, Iterator> mIndex;
+    std::size_t mCachedBytes = 0;
+};
+
+} // namespace co_async
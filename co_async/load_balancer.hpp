@@ -0,0 +1,296 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <co_async/task.hpp>
+#include <co_async/epoll_loop.hpp>
+#include <co_async/timer_loop.hpp>
+#include <co_async/when_any.hpp>
+#include <co_async/expected.hpp>
+#include <co_async/concepts.hpp>
+#include <co_async/socket.hpp>
+
+namespace co_async {
+
+struct LoadBalancerOptions {
+    // 单次请求的超时，超时按失败计，并以此作为一次延迟样本
+    std::chrono::system_clock::duration mTimeout = std::chrono::seconds(5);
+    // 连续失败达到此次数时摘除
+    std::size_t mMaxFailures = 3;
+    // 首次摘除的时长，探测失败再次摘除时加倍，不超过 mMaxEjectTime
+    std::chrono::system_clock::duration mEjectTime = std::chrono::seconds(10);
+    std::chrono::system_clock::duration mMaxEjectTime =
+        std::chrono::minutes(5);
+    // 延迟 EWMA 中新样本的权重
+    double mDecay = 0.2;
+};
+
+struct LoadBalancerBackend {
+    explicit LoadBalancerBackend(SocketAddress const &addr) noexcept
+        : mAddr(addr) {}
+
+    SocketAddress mAddr;
+    std::size_t mInflight = 0;
+    // 延迟的 EWMA，尚无样本时为 0
+    std::chrono::duration<double> mLatency{};
+    std::size_t mFailures = 0;  // 连续失败次数
+    std::size_t mEjections = 0; // 连续摘除次数
+    std::chrono::system_clock::time_point mEjectedUntil{};
+    bool mEjected = false;
+    bool mProbing = false;
+    std::uint64_t mRequests = 0;
+    std::uint64_t mErrors = 0;
+};
+
+// 客户端负载均衡：随机取两个后端，选 EWMA 延迟乘以 (在途请求数 + 1)
+// 较小的一个 (power of two choices)。连续失败或超时的后端被摘除，
+// 摘除期满后放行一个请求作为探测，成功则恢复，失败则加倍摘除时长
+struct LoadBalancer {
+    explicit LoadBalancer(EpollLoop &loop, TimerLoop &timer,
+                          std::vector<SocketAddress> const &addrs,
+                          LoadBalancerOptions options = {})
+        : mLoop(loop),
+          mTimer(timer),
+          mOptions(options),
+          mRng(std::random_device()()) {
+        if (addrs.empty()) [[unlikely]] {
+            throw std::invalid_argument("no backend to balance");
+        }
+        mBackends.reserve(addrs.size());
+        for (auto const &addr: addrs) {
+            mBackends.emplace_back(addr);
+        }
+    }
+
+    LoadBalancer &operator=(LoadBalancer &&) = delete;
+
+    // 选一个后端调用 f(addr)，记录延迟与成败；超时抛出 ETIMEDOUT。
+    // 只有系统调用出错与对端关闭计为失败，被取消或 f 自身逻辑抛出的
+    // 异常只归还在途计数
+    template <class F>
+        requires Awaitable<std::invoke_result_t<F &, SocketAddress const &>>
+    Task<typename AwaitableTraits<
+        std::invoke_result_t<F &, SocketAddress const &>>::RetType>
+    call(F f) {
+        using T = typename AwaitableTraits<
+            std::invoke_result_t<F &, SocketAddress const &>>::RetType;
+        auto start = std::chrono::system_clock::now();
+        Ticket ticket(*this, pick(start));
+        try {
+            auto v = co_await when_any(f(ticket.mBackend.mAddr),
+                                       sleep_for(mTimer, mOptions.mTimeout));
+            if (v.index() == 0) {
+                ticket.succeed(std::chrono::system_clock::now() - start);
+                if constexpr (!std::is_void_v<T>) {
+                    co_return std::move(std::get<0>(v));
+                } else {
+                    co_return;
+                }
+            }
+        } catch (std::system_error const &e) {
+            if (e.code() != std::errc::operation_canceled) {
+                ticket.fail(false);
+            }
+            throw;
+        } catch (EOFException const &) {
+            ticket.fail(false);
+            throw;
+        }
+        ticket.fail(true);
+        throw std::system_error(ETIMEDOUT, std::system_category(),
+                                "load balancer");
+    }
+
+    // 选一个后端建立 TCP 连接，此时记录的延迟只是建连耗时
+    Task<AsyncFile> connect() {
+        return call([this](SocketAddress const &addr) {
+            return create_tcp_client(mLoop, addr);
+        });
+    }
+
+    std::span<LoadBalancerBackend const> backends() const noexcept {
+        return mBackends;
+    }
+
+private:
+    // 存放在调用者的协程帧中，请求被取消时也能归还在途计数
+    struct Ticket {
+        Ticket(LoadBalancer &balancer, LoadBalancerBackend &backend) noexcept
+            : mBalancer(balancer),
+              mBackend(backend),
+              mProbe(backend.mEjected) {
+            ++mBackend.mInflight;
+        }
+
+        Ticket(Ticket &&) = delete;
+
+        ~Ticket() {
+            if (!mDone) {
+                --mBackend.mInflight;
+                if (mProbe) {
+                    mBackend.mProbing = false;
+                }
+            }
+        }
+
+        void succeed(std::chrono::system_clock::duration elapsed) noexcept {
+            mDone = true;
+            mBalancer.succeed(mBackend, elapsed, mProbe);
+        }
+
+        void fail(bool timedOut) noexcept {
+            mDone = true;
+            mBalancer.fail(mBackend, timedOut, mProbe);
+        }
+
+        LoadBalancer &mBalancer;
+        LoadBalancerBackend &mBackend;
+        bool mProbe;
+        bool mDone = false;
+    };
+
+    static bool available(LoadBalancerBackend const &b,
+                          std::chrono::system_clock::time_point now) noexcept {
+        return !b.mEjected || (!b.mProbing && now >= b.mEjectedUntil);
+    }
+
+    double cost(LoadBalancerBackend const &b) const noexcept {
+        // 尚无样本的后端按其余后端的平均延迟估计
+        double latency = b.mLatency.count();
+        if (latency == 0 && mSampled) {
+            latency = mLatencySum / double(mSampled);
+        }
+        return std::max(latency, 1e-9) * double(b.mInflight + 1);
+    }
+
+    LoadBalancerBackend &pick(std::chrono::system_clock::time_point now) {
+        LoadBalancerBackend *best = nullptr;
+        std::size_t n = mBackends.size();
+        if (n == 1) {
+            best = &mBackends[0];
+        } else {
+            std::size_t i = std::uniform_int_distribution<std::size_t>(
+                0, n - 1)(mRng);
+            std::size_t j = (i + 1 +
+                             std::uniform_int_distribution<std::size_t>(
+                                 0, n - 2)(mRng)) %
+                            n;
+            best = choose(&mBackends[i], &mBackends[j], now);
+            if (!best) [[unlikely]] {
+                best = fallback(now);
+            }
+        }
+        if (best->mEjected) {
+            best->mProbing = true;
+        }
+        return *best;
+    }
+
+    LoadBalancerBackend *choose(LoadBalancerBackend *a, LoadBalancerBackend *b,
+                                std::chrono::system_clock::time_point now) {
+        bool okA = available(*a, now), okB = available(*b, now);
+        if (okA && okB) {
+            // 摘除期满的后端优先用于探测
+            if (a->mEjected != b->mEjected) {
+                return a->mEjected ? a : b;
+            }
+            return cost(*a) <= cost(*b) ? a : b;
+        }
+        return okA ? a : okB ? b : nullptr;
+    }
+
+    // 抽中的两个都不可用时遍历全部；全部被摘除时选最早期满的一个
+    LoadBalancerBackend *fallback(std::chrono::system_clock::time_point now) {
+        LoadBalancerBackend *best = nullptr;
+        for (auto &b: mBackends) {
+            if (available(b, now)) {
+                if (!best || (b.mEjected && !best->mEjected) ||
+                    (b.mEjected == best->mEjected && cost(b) < cost(*best))) {
+                    best = &b;
+                }
+            }
+        }
+        if (!best) {
+            best = &*std::min_element(
+                mBackends.begin(), mBackends.end(),
+                [](auto const &a, auto const &b) {
+                    return a.mEjectedUntil < b.mEjectedUntil;
+                });
+        }
+        return best;
+    }
+
+    void sample(LoadBalancerBackend &b,
+                std::chrono::system_clock::duration elapsed) noexcept {
+        double old = b.mLatency.count();
+        double x =
+            std::max(std::chrono::duration<double>(elapsed).count(), 1e-9);
+        double now = old == 0 ? x : old + mOptions.mDecay * (x - old);
+        if (old == 0) {
+            ++mSampled;
+        }
+        mLatencySum += now - old;
+        b.mLatency = std::chrono::duration<double>(now);
+    }
+
+    void succeed(LoadBalancerBackend &b,
+                 std::chrono::system_clock::duration elapsed,
+                 bool probe) noexcept {
+        --b.mInflight;
+        ++b.mRequests;
+        sample(b, elapsed);
+        b.mFailures = 0;
+        if (probe) {
+            b.mEjected = false;
+            b.mProbing = false;
+            b.mEjections = 0;
+        }
+    }
+
+    void fail(LoadBalancerBackend &b, bool timedOut, bool probe) noexcept {
+        --b.mInflight;
+        ++b.mRequests;
+        ++b.mErrors;
+        if (timedOut) {
+            sample(b, mOptions.mTimeout);
+        }
+        // 摘除前发出的请求随后失败，不再重复摘除
+        if (b.mEjected && !probe) {
+            return;
+        }
+        if (probe || ++b.mFailures >= mOptions.mMaxFailures) {
+            auto duration = mOptions.mEjectTime;
+            for (std::size_t i = 0;
+                 i < b.mEjections && duration < mOptions.mMaxEjectTime; ++i) {
+                duration *= 2;
+            }
+            b.mEjectedUntil = std::chrono::system_clock::now() +
+                              std::min(duration, mOptions.mMaxEjectTime);
+            b.mEjected = true;
+            b.mProbing = false;
+            b.mFailures = 0;
+            ++b.mEjections;
+        }
+    }
+
+    EpollLoop &mLoop;
+    TimerLoop &mTimer;
+    LoadBalancerOptions mOptions;
+    std::vector<LoadBalancerBackend> mBackends;
+    std::minstd_rand mRng;
+    // 已有样本的后端的延迟之和与个数
+    double mLatencySum = 0;
+    std::size_t mSampled = 0;
+};
+
+} // namespace co_async
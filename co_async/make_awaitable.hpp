@@ -1,20 +1,38 @@
 #pragma once
 
+#include <coroutine>
+#include <type_traits>
 #include <utility>
-#include <co_async/task.hpp>
 #include <co_async/concepts.hpp>
 
 namespace co_async {
 
+// 已经就绪的值，co_await 时不挂起，直接取出
+template <class T>
+struct ReadyAwaiter {
+    bool await_ready() const noexcept {
+        return true;
+    }
+
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+
+    T await_resume() noexcept(std::is_nothrow_move_constructible_v<T>) {
+        return std::forward<T>(mValue);
+    }
+
+    T mValue;
+};
+
 template <Awaitable A>
 A &&make_awaitable(A &&a) {
     return std::forward<A>(a);
 }
 
+// 不再为普通值创建一个协程帧，左值以引用保存
 template <class A>
     requires(!Awaitable<A>)
-Task<A> make_awaitable(A &&a) {
-    co_return std::forward<A>(a);
+ReadyAwaiter<A> make_awaitable(A &&a) {
+    return ReadyAwaiter<A>{std::forward<A>(a)};
 }
 
 } // namespace co_async
@@ -4,8 +4,16 @@
 
 namespace co_async {
 
+// 完成回调：组合器直接启动子任务时记在子任务的 promise 里，子任务结束
+// (生成器还有 co_yield) 时调用它而不是恢复某个等待者，由返回值决定
+// 接着恢复哪个协程，不必为子任务再创建一个协程帧作为 continuation
+struct CompletionHook {
+    std::coroutine_handle<> (*mCallback)(CompletionHook &) noexcept;
+};
+
 struct PreviousAwaiter {
     std::coroutine_handle<> mPrevious;
+    CompletionHook *mHook = nullptr;
 
     bool await_ready() const noexcept {
         return false;
@@ -13,6 +21,9 @@ struct PreviousAwaiter {
 
     std::coroutine_handle<>
     await_suspend(std::coroutine_handle<> coroutine) const noexcept {
+        if (mHook) {
+            return mHook->mCallback(*mHook);
+        }
         return mPrevious;
     }
 
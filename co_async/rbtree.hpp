@@ -220,28 +220,88 @@ private:
     /*     } */
     /* } */
 
+    void fixErase(RbNode *node, RbNode *parent) noexcept {
+        // node 所在的子树少了一个黑节点，node 可能为空，故单独传入 parent
+        while (node != root && (node == nullptr || node->color == BLACK)) {
+            if (node == parent->left) {
+                RbNode *sibling = parent->right;
+                if (sibling->color == RED) {
+                    sibling->color = BLACK;
+                    parent->color = RED;
+                    rotateLeft(parent);
+                    sibling = parent->right;
+                }
+                if ((sibling->left == nullptr ||
+                     sibling->left->color == BLACK) &&
+                    (sibling->right == nullptr ||
+                     sibling->right->color == BLACK)) {
+                    sibling->color = RED;
+                    node = parent;
+                    parent = node->parent;
+                } else {
+                    if (sibling->right == nullptr ||
+                        sibling->right->color == BLACK) {
+                        sibling->left->color = BLACK;
+                        sibling->color = RED;
+                        rotateRight(sibling);
+                        sibling = parent->right;
+                    }
+                    sibling->color = parent->color;
+                    parent->color = BLACK;
+                    sibling->right->color = BLACK;
+                    rotateLeft(parent);
+                    node = root;
+                }
+            } else {
+                RbNode *sibling = parent->left;
+                if (sibling->color == RED) {
+                    sibling->color = BLACK;
+                    parent->color = RED;
+                    rotateRight(parent);
+                    sibling = parent->left;
+                }
+                if ((sibling->left == nullptr ||
+                     sibling->left->color == BLACK) &&
+                    (sibling->right == nullptr ||
+                     sibling->right->color == BLACK)) {
+                    sibling->color = RED;
+                    node = parent;
+                    parent = node->parent;
+                } else {
+                    if (sibling->left == nullptr ||
+                        sibling->left->color == BLACK) {
+                        sibling->right->color = BLACK;
+                        sibling->color = RED;
+                        rotateLeft(sibling);
+                        sibling = parent->left;
+                    }
+                    sibling->color = parent->color;
+                    parent->color = BLACK;
+                    sibling->left->color = BLACK;
+                    rotateRight(parent);
+                    node = root;
+                }
+            }
+        }
+        if (node != nullptr) {
+            node->color = BLACK;
+        }
+    }
+
     void doErase(RbNode *current) noexcept {
         current->tree = nullptr;
 
-        RbNode *node = nullptr;
         RbNode *child = nullptr;
+        RbNode *parent = nullptr;
         RbColor color = RED;
 
         if (current->left != nullptr && current->right != nullptr) {
-            RbNode *replace = current;
-            replace = replace->right;
+            // 用右子树的最小节点 replace 顶替 current 的位置与颜色
+            RbNode *replace = current->right;
             while (replace->left != nullptr) {
                 replace = replace->left;
             }
 
-            if (current != replace->parent) {
-                current->parent->left = replace->right;
-                replace->right = current->right;
-                current->right->parent = replace;
-            } else {
-                replace->parent = current;
-            }
-
             if (current == root) {
                 root = replace;
             } else if (current->parent->left == current) {
@@ -250,32 +310,47 @@ private:
                 current->parent->right = replace;
             }
 
+            child = replace->right;
+            parent = replace->parent;
+            color = replace->color;
+
+            if (parent == current) {
+                parent = replace;
+            } else {
+                if (child != nullptr) {
+                    child->parent = parent;
+                }
+                parent->left = child;
+                replace->right = current->right;
+                current->right->parent = replace;
+            }
+
+            replace->parent = current->parent;
+            replace->color = current->color;
             replace->left = current->left;
             current->left->parent = replace;
-
-            node = replace;
-            color = node->color;
-            child = node->right;
         } else {
-            node = current;
-            color = node->color;
-            child = (node->left != nullptr) ? node->left : node->right;
-        }
+            child = (current->left != nullptr) ? current->left : current->right;
+            parent = current->parent;
+            color = current->color;
 
-        if (child != nullptr) {
-            child->parent = node->parent;
-        }
+            if (child != nullptr) {
+                child->parent = parent;
+            }
 
-        if (node == root) {
-            root = child;
-        } else if (node->parent->left == node) {
-            node->parent->left = child;
-        } else {
-            node->parent->right = child;
+            if (current == root) {
+                root = child;
+            } else if (parent->left == current) {
+                parent->left = child;
+            } else {
+                parent->right = child;
+            }
         }
 
-        if (color == BLACK && root) {
-            fixViolation(child ? child : node->parent);
+        current->left = current->right = current->parent = nullptr;
+
+        if (color == BLACK) {
+            fixErase(child, parent);
         }
     }
 
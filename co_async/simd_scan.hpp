@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstddef>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CO_ASYNC_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace co_async {
+
+// HTTP 头部分词所需的两种扫描：
+//   findCtl    第一个控制字符 (\t 除外，含 \r \n 与 DEL)，即行尾或非法字符
+//   findKeyEnd 第一个 ':'、空白或控制字符，即头部名的结束处
+// 返回下标，找不到时返回 n
+struct HTTPTokenizer {
+    using ScanFn = std::size_t (*)(char const *p, std::size_t n) noexcept;
+
+    ScanFn findCtl;
+    ScanFn findKeyEnd;
+    char const *name;
+
+    static inline HTTPTokenizer const &scalar() noexcept;
+#if CO_ASYNC_SIMD_X86
+    static inline HTTPTokenizer const &sse42() noexcept;
+    static inline HTTPTokenizer const &avx2() noexcept;
+#endif
+    // 按运行时 CPU 特性选择最快的实现
+    static inline HTTPTokenizer const &best() noexcept;
+};
+
+inline bool httpIsCtl(unsigned char c) noexcept {
+    return (c < 0x20 && c != '\t') || c == 0x7f;
+}
+
+inline bool httpIsKeyEnd(unsigned char c) noexcept {
+    return c <= 0x20 || c == ':' || c == 0x7f;
+}
+
+inline std::size_t httpFindCtlScalar(char const *p, std::size_t n) noexcept {
+    for (std::size_t i = 0; i < n; ++i) {
+        if (httpIsCtl(p[i])) {
+            return i;
+        }
+    }
+    return n;
+}
+
+inline std::size_t httpFindKeyEndScalar(char const *p,
+                                        std::size_t n) noexcept {
+    for (std::size_t i = 0; i < n; ++i) {
+        if (httpIsKeyEnd(p[i])) {
+            return i;
+        }
+    }
+    return n;
+}
+
+#if CO_ASYNC_SIMD_X86
+// pcmpestri 的区间匹配模式，一条指令比较 16 字节与最多 8 个区间
+__attribute__((target("sse4.2"))) inline std::size_t
+httpFindCtlSSE42(char const *p, std::size_t n) noexcept {
+    __m128i const ranges = _mm_setr_epi8('\x00', '\x08', '\x0a', '\x1f',
+                                         '\x7f', '\x7f', 0, 0, 0, 0, 0, 0, 0,
+                                         0, 0, 0);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i const *)(p + i));
+        int idx = _mm_cmpestri(ranges, 6, v, 16,
+                               _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES |
+                                   _SIDD_LEAST_SIGNIFICANT);
+        if (idx != 16) {
+            return i + idx;
+        }
+    }
+    if (i != n && n >= 16) {
+        // 尾部与上一块重叠地再比较一次，前面的字节已确认不匹配
+        i = n - 16;
+        __m128i v = _mm_loadu_si128((__m128i const *)(p + i));
+        return i + _mm_cmpestri(ranges, 6, v, 16,
+                                _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES |
+                                    _SIDD_LEAST_SIGNIFICANT);
+    }
+    return i + httpFindCtlScalar(p + i, n - i);
+}
+
+__attribute__((target("sse4.2"))) inline std::size_t
+httpFindKeyEndSSE42(char const *p, std::size_t n) noexcept {
+    __m128i const ranges = _mm_setr_epi8('\x00', '\x20', ':', ':', '\x7f',
+                                         '\x7f', 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                         0);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i const *)(p + i));
+        int idx = _mm_cmpestri(ranges, 6, v, 16,
+                               _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES |
+                                   _SIDD_LEAST_SIGNIFICANT);
+        if (idx != 16) {
+            return i + idx;
+        }
+    }
+    if (i != n && n >= 16) {
+        i = n - 16;
+        __m128i v = _mm_loadu_si128((__m128i const *)(p + i));
+        return i + _mm_cmpestri(ranges, 6, v, 16,
+                                _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES |
+                                    _SIDD_LEAST_SIGNIFICANT);
+    }
+    return i + httpFindKeyEndScalar(p + i, n - i);
+}
+
+// AVX2 没有无符号字节比较，用 min_epu8(v, k) == v 表示 v <= k
+__attribute__((target("avx2"))) inline unsigned
+httpCtlMaskAVX2(char const *p) noexcept {
+    __m256i v = _mm256_loadu_si256((__m256i const *)p);
+    __m256i ctl =
+        _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1f)), v);
+    ctl = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                              ctl);
+    ctl = _mm256_or_si256(ctl, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f)));
+    return (unsigned)_mm256_movemask_epi8(ctl);
+}
+
+__attribute__((target("avx2"))) inline unsigned
+httpKeyEndMaskAVX2(char const *p) noexcept {
+    __m256i v = _mm256_loadu_si256((__m256i const *)p);
+    __m256i end =
+        _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x20)), v);
+    end = _mm256_or_si256(end, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')));
+    end = _mm256_or_si256(end, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f)));
+    return (unsigned)_mm256_movemask_epi8(end);
+}
+
+template <unsigned (*Mask)(char const *) noexcept,
+          std::size_t (*Short)(char const *, std::size_t) noexcept>
+__attribute__((target("avx2"))) inline std::size_t
+httpScanAVX2(char const *p, std::size_t n) noexcept {
+    if (n < 32) {
+        return Short(p, n);
+    }
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        if (unsigned mask = Mask(p + i)) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    if (i != n) {
+        i = n - 32;
+        if (unsigned mask = Mask(p + i)) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return n;
+}
+
+__attribute__((target("avx2"))) inline std::size_t
+httpFindCtlAVX2(char const *p, std::size_t n) noexcept {
+    return httpScanAVX2<httpCtlMaskAVX2, httpFindCtlSSE42>(p, n);
+}
+
+__attribute__((target("avx2"))) inline std::size_t
+httpFindKeyEndAVX2(char const *p, std::size_t n) noexcept {
+    return httpScanAVX2<httpKeyEndMaskAVX2, httpFindKeyEndSSE42>(p, n);
+}
+
+HTTPTokenizer const &HTTPTokenizer::sse42() noexcept {
+    static HTTPTokenizer const t{httpFindCtlSSE42, httpFindKeyEndSSE42,
+                                 "sse4.2"};
+    return t;
+}
+
+HTTPTokenizer const &HTTPTokenizer::avx2() noexcept {
+    static HTTPTokenizer const t{httpFindCtlAVX2, httpFindKeyEndAVX2, "avx2"};
+    return t;
+}
+#endif
+
+HTTPTokenizer const &HTTPTokenizer::scalar() noexcept {
+    static HTTPTokenizer const t{httpFindCtlScalar, httpFindKeyEndScalar,
+                                 "scalar"};
+    return t;
+}
+
+HTTPTokenizer const &HTTPTokenizer::best() noexcept {
+    static HTTPTokenizer const &t = []() -> HTTPTokenizer const & {
+#if CO_ASYNC_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return avx2();
+        }
+        if (__builtin_cpu_supports("sse4.2")) {
+            return sse42();
+        }
+#endif
+        return scalar();
+    }();
+    return t;
+}
+
+} // namespace co_async
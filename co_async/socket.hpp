@@ -1,9 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <cerrno>
 #include <span>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <variant>
+#include <vector>
 #include <cstring>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -13,10 +17,13 @@
 #include <netinet/in.h>
 #include <netdb.h>
 #include <sys/un.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
 #include <co_async/task.hpp>
 #include <co_async/generator.hpp>
 #include <co_async/epoll_loop.hpp>
 #include <co_async/error_handling.hpp>
+#include <co_async/stream_base.hpp>
 
 namespace co_async {
 
@@ -28,6 +35,8 @@ struct IpAddress {
     std::variant<in_addr, in6_addr> mAddr;
 };
 
+// 域名经 gethostbyname 同步解析，会阻塞事件循环，
+// 在协程中应改用 DnsResolver::resolve
 inline IpAddress ip_address(char const *ip) {
     in_addr addr = {};
     in6_addr addr6 = {};
@@ -50,6 +59,57 @@ inline IpAddress ip_address(char const *ip) {
     throw std::invalid_argument("invalid domain name or ip address");
 }
 
+// 按 RFC 8305 交替排列 IPv6 与 IPv4，各族内保持原有顺序
+inline std::vector<IpAddress>
+interleaveAddresses(std::vector<IpAddress> const &addrs) {
+    std::vector<IpAddress> v4, v6;
+    for (auto const &addr: addrs) {
+        (addr.mAddr.index() == 0 ? v4 : v6).push_back(addr);
+    }
+    std::vector<IpAddress> ips;
+    ips.reserve(v4.size() + v6.size());
+    for (std::size_t i = 0; i < std::max(v4.size(), v6.size()); ++i) {
+        if (i < v6.size()) {
+            ips.push_back(v6[i]);
+        }
+        if (i < v4.size()) {
+            ips.push_back(v4[i]);
+        }
+    }
+    return ips;
+}
+
+// 解析出全部地址，交替排列 IPv6 与 IPv4，供 connect_any 依次尝试；
+// 会阻塞事件循环，在协程中应改用 DnsResolver 与 connect_host
+inline std::vector<IpAddress> ip_addresses(char const *host) {
+    in_addr addr = {};
+    in6_addr addr6 = {};
+    if (checkError(inet_pton(AF_INET, host, &addr))) {
+        return {addr};
+    }
+    if (checkError(inet_pton(AF_INET6, host, &addr6))) {
+        return {addr6};
+    }
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    int err = getaddrinfo(host, nullptr, &hints, &res);
+    if (err != 0) [[unlikely]] {
+        throw std::invalid_argument(gai_strerror(err));
+    }
+    std::vector<IpAddress> ips;
+    for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+        if (ai->ai_family == AF_INET) {
+            ips.emplace_back(((sockaddr_in *)ai->ai_addr)->sin_addr);
+        } else if (ai->ai_family == AF_INET6) {
+            ips.emplace_back(((sockaddr_in6 *)ai->ai_addr)->sin6_addr);
+        }
+    }
+    freeaddrinfo(res);
+    return interleaveAddresses(ips);
+}
+
 struct SocketAddress {
     SocketAddress() = default;
 
@@ -93,6 +153,16 @@ inline SocketAddress socket_address(IpAddress ip, int port) {
         [&](auto const &addr) { return SocketAddress(addr, port); }, ip.mAddr);
 }
 
+inline std::vector<SocketAddress>
+socket_addresses(std::vector<IpAddress> const &ips, int port) {
+    std::vector<SocketAddress> addrs;
+    addrs.reserve(ips.size());
+    for (auto const &ip: ips) {
+        addrs.push_back(socket_address(ip, port));
+    }
+    return addrs;
+}
+
 inline SocketAddress socketGetAddress(AsyncFile &sock) {
     SocketAddress sa;
     sa.mAddrLen = sizeof(sa.mAddr);
@@ -137,22 +207,20 @@ inline Task<AsyncFile> create_tcp_client(EpollLoop &loop,
     co_return sock;
 }
 
-inline Task<void> socketBind(EpollLoop &loop, AsyncFile &sock, auto const &addr,
-                             int backlog = SOMAXCONN) {
+inline void socketBind(AsyncFile &sock, SocketAddress const &addr,
+                       int backlog = SOMAXCONN) {
     sock.setNonblock();
+    socketSetOption(sock, SOL_SOCKET, SO_REUSEADDR, 1);
     checkError(
         bind(sock.fileNo(), (sockaddr const *)&addr.mAddr, addr.mAddrLen));
-    co_await wait_file_event(loop, sock, EPOLLOUT);
-    int err = socketGetOption<int>(sock, SOL_SOCKET, SO_ERROR);
-    if (err != 0) [[unlikely]] {
-        throw std::system_error(err, std::system_category(), "bind");
-    }
+    checkError(listen(sock.fileNo(), backlog));
 }
 
-inline Task<AsyncFile> create_tcp_server(EpollLoop &loop,
-                                         SocketAddress const &addr) {
-    AsyncFile sock(socket(addr.mAddr.ss_family, SOCK_STREAM, 0));
-    co_await socketBind(loop, sock, addr);
+inline Task<AsyncFile> create_tcp_server([[maybe_unused]] EpollLoop &loop,
+                                         SocketAddress const &addr,
+                                         int backlog = SOMAXCONN) {
+    AsyncFile sock(checkError(socket(addr.mAddr.ss_family, SOCK_STREAM, 0)));
+    socketBind(sock, addr, backlog);
     co_return sock;
 }
 
@@ -164,15 +232,119 @@ inline void socket_shotdown(AsyncFile &sock, int flags = SHUT_RDWR) {
     checkError(shutdown(sock.fileNo(), flags));
 }
 
-template <class AddrType>
-inline Task<std::tuple<AsyncFile, AddrType>> socket_accept(EpollLoop &loop,
-                                                           AsyncFile &sock) {
-    AddrType addr;
-    socklen_t addrLen = sizeof(addr.mSockAddr);
-    co_await wait_file_event(loop, sock, EPOLLIN);
-    int res = checkError(accept4(sock.fileNo(), (sockaddr *)&addr.mSockAddr,
-                                 &addrLen, SOCK_NONBLOCK));
+// 非阻塞地从 accept 队列取出一个连接，队列为空时返回 -1
+inline int socketAcceptSync(AsyncFile &sock, SocketAddress &addr) {
+    while (true) {
+        addr.mAddrLen = sizeof(addr.mAddr);
+        int res = accept4(sock.fileNo(), (sockaddr *)&addr.mAddr,
+                          &addr.mAddrLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (res != -1) [[likely]] {
+            return res;
+        }
+        switch (errno) {
+        case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+        case EWOULDBLOCK:
+#endif
+            return -1;
+        case EINTR:
+        case ECONNABORTED:
+        case EPROTO:
+            continue; // 对端在 accept 前已放弃，继续取下一个
+        default:
+            throw std::system_error(errno, std::system_category(), "accept4");
+        }
+    }
+}
+
+inline Task<std::tuple<AsyncFile, SocketAddress>>
+socket_accept(EpollLoop &loop, AsyncFile &sock) {
+    SocketAddress addr;
+    int res = socketAcceptSync(sock, addr);
+    while (res == -1) {
+        co_await wait_file_event(loop, sock, EPOLLIN);
+        res = socketAcceptSync(sock, addr);
+    }
     co_return {AsyncFile(res), addr};
 }
 
+// 尽量清空 accept 队列，最多取 maxCount 个连接；与 socket_accept 相同，
+// 先直接 accept，队列为空时才等待可读，上一批因 maxCount 截断时不必再等
+inline Task<std::size_t>
+socket_accept_batch(EpollLoop &loop, AsyncFile &sock,
+                    std::vector<std::tuple<AsyncFile, SocketAddress>> &out,
+                    std::size_t maxCount) {
+    std::size_t count = 0;
+    SocketAddress addr;
+    while (true) {
+        while (count < maxCount) {
+            int res = socketAcceptSync(sock, addr);
+            if (res == -1) {
+                break;
+            }
+            out.emplace_back(AsyncFile(res), addr);
+            ++count;
+        }
+        if (count != 0) {
+            break;
+        }
+        co_await wait_file_event(loop, sock, EPOLLIN);
+    }
+    co_return count;
+}
+
+inline std::size_t socketWritevSync(AsyncFile &sock,
+                                    std::span<struct iovec> iov) {
+    struct msghdr msg {};
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = iov.size();
+    // 对端已关闭时得到 EPIPE 而不是 SIGPIPE
+    return checkErrorNonBlock(sendmsg(sock.fileNo(), &msg, MSG_NOSIGNAL));
+}
+
+// 把 iov 中的数据全部写出，会修改 iov；先直接写，写不进时才等待可写
+inline Task<> socket_writev(EpollLoop &loop, AsyncFile &sock,
+                            std::span<struct iovec> iov) {
+    while (true) {
+        while (!iov.empty() && iov.front().iov_len == 0) {
+            iov = iov.subspan(1);
+        }
+        if (iov.empty()) {
+            break;
+        }
+        std::size_t len = socketWritevSync(sock, iov);
+        if (len == 0) {
+            co_await wait_file_event(loop, sock, EPOLLOUT | EPOLLHUP);
+            continue;
+        }
+        while (len != 0 && len >= iov.front().iov_len) {
+            len -= iov.front().iov_len;
+            iov = iov.subspan(1);
+        }
+        if (len != 0) {
+            auto &front = iov.front();
+            front.iov_base = static_cast<char *>(front.iov_base) + len;
+            front.iov_len -= len;
+        }
+    }
+}
+
+// 把 file 中从 offset 起的 count 字节发送到 sock，文件提前结束时抛出
+// EOFException；sendfile 没有 MSG_NOSIGNAL，调用者需忽略 SIGPIPE
+inline Task<> socket_sendfile(EpollLoop &loop, AsyncFile &sock, AsyncFile &file,
+                              off_t offset, std::size_t count) {
+    while (count != 0) {
+        auto len = checkErrorNonBlock(
+            sendfile(sock.fileNo(), file.fileNo(), &offset, count), -1);
+        if (len == -1) {
+            co_await wait_file_event(loop, sock, EPOLLOUT | EPOLLHUP);
+            continue;
+        }
+        if (len == 0) [[unlikely]] {
+            throw EOFException();
+        }
+        count -= len;
+    }
+}
+
 } // namespace co_async
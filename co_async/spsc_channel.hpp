@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <co_async/epoll_loop.hpp>
+#include <co_async/error_handling.hpp>
+#include <co_async/generator.hpp>
+#include <co_async/task.hpp>
+#include <co_async/uninitialized.hpp>
+
+namespace co_async {
+
+// 跨线程的单生产者单消费者通道，两端各在自己线程的事件循环上运行。
+// 环形缓冲区的读写下标由两端各自推进，只靠原子变量同步，不加锁；
+// 只有一端需要等待时才经 eventfd 唤醒它，平常的收发不进入内核
+template <class T, std::size_t N>
+struct SpscChannel {
+    static_assert(N != 0, "SpscChannel needs a buffer");
+
+    SpscChannel()
+        : mNotEmpty(checkError(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))),
+          mNotFull(checkError(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {}
+
+    SpscChannel(SpscChannel &&) = delete;
+
+    ~SpscChannel() {
+        std::size_t tail = mTail.load(std::memory_order_relaxed);
+        for (std::size_t head = mHead.load(std::memory_order_relaxed);
+             head != tail; ++head) {
+            mBuffer[head % N].moveValue();
+        }
+    }
+
+    // 仅由生产者调用；缓冲区满或通道已关闭时返回 false，value 不被移走
+    bool try_send(T &&value) {
+        if (closed()) {
+            return false;
+        }
+        std::size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHeadCache == N) {
+            mHeadCache = mHead.load(std::memory_order_acquire);
+            if (tail - mHeadCache == N) {
+                return false;
+            }
+        }
+        mBuffer[tail % N].putValue(std::move(value));
+        mTail.store(tail + 1, std::memory_order_release);
+        wake(mConsumerWaiting, mNotEmpty);
+        return true;
+    }
+
+    // 仅由消费者调用；缓冲区空时返回 nullopt
+    std::optional<T> try_recv() {
+        std::size_t head = mHead.load(std::memory_order_relaxed);
+        if (head == mTailCache) {
+            mTailCache = mTail.load(std::memory_order_acquire);
+            if (head == mTailCache) {
+                return std::nullopt;
+            }
+        }
+        std::optional<T> value(std::in_place, mBuffer[head % N].moveValue());
+        mHead.store(head + 1, std::memory_order_release);
+        wake(mProducerWaiting, mNotFull);
+        return value;
+    }
+
+    // 缓冲区满时在生产者的 loop 上等待，通道关闭时返回 false
+    Task<bool> send(EpollLoop &loop, T value) {
+        while (!try_send(std::move(value))) {
+            if (closed()) {
+                co_return false;
+            }
+            mProducerWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (mTail.load(std::memory_order_relaxed) -
+                        mHead.load(std::memory_order_relaxed) ==
+                    N &&
+                !closed()) {
+                co_await wait_file_event(loop, mNotFull, EPOLLIN);
+            }
+            mProducerWaiting.store(false, std::memory_order_relaxed);
+            drain(mNotFull);
+        }
+        co_return true;
+    }
+
+    // 缓冲区空时在消费者的 loop 上等待，通道关闭且取完后返回 nullopt
+    Task<std::optional<T>> recv(EpollLoop &loop) {
+        while (true) {
+            if (auto value = try_recv()) {
+                co_return value;
+            }
+            if (closed()) {
+                // 关闭前发送的元素在关闭时已经可见
+                co_return try_recv();
+            }
+            mConsumerWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (mHead.load(std::memory_order_relaxed) ==
+                    mTail.load(std::memory_order_relaxed) &&
+                !closed()) {
+                co_await wait_file_event(loop, mNotEmpty, EPOLLIN);
+            }
+            mConsumerWaiting.store(false, std::memory_order_relaxed);
+            drain(mNotEmpty);
+        }
+    }
+
+    // 两端都可以调用，唤醒正在等待的另一端
+    void close() {
+        mClosed.store(true, std::memory_order_seq_cst);
+        eventfd_write(mNotEmpty.fileNo(), 1);
+        eventfd_write(mNotFull.fileNo(), 1);
+    }
+
+    bool closed() const noexcept {
+        return mClosed.load(std::memory_order_acquire);
+    }
+
+    // 把通道作为消费者一端的 Generator 数据源
+    Generator<T> source(EpollLoop &loop) {
+        while (auto value = co_await recv(loop)) {
+            co_yield std::move(*value);
+        }
+    }
+
+private:
+    // 与 send / recv 中等待前的检查配对：一方先写下标再读等待标志，
+    // 另一方先写等待标志再读下标，两边的栅栏保证至少一方看到对方的写入
+    static void wake(std::atomic<bool> &waiting, AsyncFile &event) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed) &&
+            waiting.exchange(false, std::memory_order_relaxed)) {
+            eventfd_write(event.fileNo(), 1);
+        }
+    }
+
+    // 清除多余的通知，之后会重新检查缓冲区
+    static void drain(AsyncFile &event) {
+        eventfd_t count;
+        eventfd_read(event.fileNo(), &count);
+    }
+
+    // 消费者写 mHead，生产者写 mTail，分开放在不同的缓存行；
+    // 等待标志每次收发都要读，很少写，也单独放一行
+    alignas(64) std::atomic<std::size_t> mHead{0};
+    std::size_t mTailCache = 0;
+    alignas(64) std::atomic<std::size_t> mTail{0};
+    std::size_t mHeadCache = 0;
+    alignas(64) std::atomic<bool> mConsumerWaiting{false};
+    std::atomic<bool> mProducerWaiting{false};
+    std::atomic<bool> mClosed{false};
+    AsyncFile mNotEmpty;
+    AsyncFile mNotFull;
+    std::array<Uninitialized<T>, N> mBuffer;
+};
+
+} // namespace co_async
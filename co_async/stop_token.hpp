@@ -0,0 +1,147 @@
+#pragma once
+
+#include <coroutine>
+#include <system_error>
+#include <co_async/wait_queue.hpp>
+
+namespace co_async {
+
+struct StopSource;
+
+// 因请求停止而中止的操作抛出的异常
+[[noreturn]] inline void throwOperationCanceled() {
+    throw std::system_error(
+        std::make_error_code(std::errc::operation_canceled));
+}
+
+// 请求停止时调用的回调，节点存放在注册者 (通常是 awaiter) 里，
+// 析构时自动注销；回调调用前已经摘下
+struct StopCallbackNode : WaitQueueNode {
+    explicit StopCallbackNode(void (*func)(StopCallbackNode &)) noexcept
+        : mFunc(func) {}
+
+    StopCallbackNode(StopCallbackNode &&) = delete;
+
+    ~StopCallbackNode() {
+        this->unlink();
+    }
+
+    void (*mFunc)(StopCallbackNode &);
+};
+
+// 借用 StopSource 的令牌，StopSource 必须比持有令牌的协程活得久；
+// 空令牌永远不会被请求停止
+struct StopToken {
+    inline bool stop_requested() const noexcept;
+
+    bool stop_possible() const noexcept {
+        return mSource != nullptr;
+    }
+
+    // 已请求停止或令牌为空时不注册，返回 false
+    inline bool attach(StopCallbackNode &node) const noexcept;
+
+    void throw_if_stop_requested() const {
+        if (stop_requested()) [[unlikely]] {
+            throwOperationCanceled();
+        }
+    }
+
+    StopSource *mSource{};
+};
+
+// 只在一个事件循环内使用的停止源。request_stop 依次调用已注册的回调，
+// 等待 I/O 或定时器的 awaiter 借此从事件循环注销并排入 ReadyQueue，
+// 被恢复的协程抛出 errc::operation_canceled 的 system_error 逐层退出
+struct StopSource {
+    StopSource() = default;
+    StopSource(StopSource &&) = delete;
+
+    ~StopSource() {
+        while (mCallbacks.popFront()) {
+        }
+    }
+
+    StopToken get_token() noexcept {
+        return StopToken{this};
+    }
+
+    bool stop_requested() const noexcept {
+        return mStopped;
+    }
+
+    // 返回 false 表示之前已经请求过；回调中恢复的协程可能注销其他回调，
+    // 因此每次都从队首重新取
+    bool request_stop() {
+        if (mStopped) {
+            return false;
+        }
+        mStopped = true;
+        while (WaitQueueNode *node = mCallbacks.popFront()) {
+            auto &callback = static_cast<StopCallbackNode &>(*node);
+            callback.mFunc(callback);
+        }
+        return true;
+    }
+
+private:
+    friend StopToken;
+
+    bool mStopped = false;
+    WaitQueue mCallbacks;
+};
+
+bool StopToken::stop_requested() const noexcept {
+    return mSource && mSource->mStopped;
+}
+
+bool StopToken::attach(StopCallbackNode &node) const noexcept {
+    if (!mSource || mSource->mStopped) {
+        return false;
+    }
+    mSource->mCallbacks.pushBack(&node);
+    return true;
+}
+
+// 等待者的 promise 中的 StopToken，伪造的协程帧等没有 promise 的为空
+template <class P>
+StopToken stopTokenOf(std::coroutine_handle<P> coroutine) noexcept {
+    if constexpr (requires { coroutine.promise().mStopToken; }) {
+        return coroutine.promise().mStopToken;
+    } else {
+        return {};
+    }
+}
+
+// 组合器以伪造的帧等待子任务，由此把自己的 StopToken 交给子任务的 awaiter
+template <class A>
+void inheritStopToken(A &awaiter, StopToken token) noexcept {
+    if constexpr (requires { awaiter.inherit_stop_token(token); }) {
+        awaiter.inherit_stop_token(token);
+    }
+}
+
+// co_await get_stop_token() 取得当前协程的 StopToken，不挂起
+struct GetStopTokenAwaiter {
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    template <class P>
+    bool await_suspend(std::coroutine_handle<P> coroutine) noexcept {
+        mToken = stopTokenOf(coroutine);
+        return false;
+    }
+
+    StopToken await_resume() const noexcept {
+        return mToken;
+    }
+
+    StopToken mToken;
+};
+
+inline GetStopTokenAwaiter get_stop_token() noexcept {
+    return {};
+}
+
+} // namespace co_async
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <span>
 #include <utility>
 #include <string>
@@ -26,6 +27,15 @@ struct FileBuf {
     Task<std::size_t> write(std::span<char const> buffer) {
         return write_file(*mLoop, mFile, buffer);
     }
+
+    Task<Expected<std::size_t>> read_expected(std::span<char> buffer) {
+        return try_read_file(*mLoop, mFile, buffer);
+    }
+
+    Task<Expected<std::size_t>>
+    write_expected(std::span<char const> buffer) {
+        return try_write_file(*mLoop, mFile, buffer);
+    }
 };
 
 using FileIStream = IStream<FileBuf>;
@@ -56,6 +66,15 @@ struct StdioBuf {
     Task<std::size_t> write(std::span<char const> buffer) {
         return write_file(*mLoop, mFileOut, buffer);
     }
+
+    Task<Expected<std::size_t>> read_expected(std::span<char> buffer) {
+        return try_read_file(*mLoop, mFileIn, buffer);
+    }
+
+    Task<Expected<std::size_t>>
+    write_expected(std::span<char const> buffer) {
+        return try_write_file(*mLoop, mFileOut, buffer);
+    }
 };
 
 using StdioStream = IOStream<StdioBuf>;
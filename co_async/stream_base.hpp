@@ -1,19 +1,22 @@
 #pragma once
 
+#include <algorithm>
 #include <concepts>
 #include <cstdint>
+#include <cstring>
 #include <span>
 #include <vector>
 #include <string>
+#include <system_error>
 #include <utility>
 #include <optional>
 #include <memory>
+#include <co_async/expected.hpp>
+#include <co_async/stop_token.hpp>
 #include <co_async/task.hpp>
 
 namespace co_async {
 
-struct EOFException {};
-
 template <class Reader>
 struct IStreamBase {
     explicit IStreamBase(std::size_t bufferSize = 8192)
@@ -78,12 +81,89 @@ struct IStreamBase {
         co_return s;
     }
 
+    // 缓冲区中尚未读取的内容，可在原地解析
+    std::span<char> peekBuffer() noexcept {
+        return std::span(mBuffer.get() + mIndex, mEnd - mIndex);
+    }
+
+    void consumeBuffer(std::size_t n) noexcept {
+        mIndex += n;
+    }
+
+    // 保留未读内容并追加读入，缓冲区已满时返回 false
+    Task<bool> fillMore() {
+        if (mIndex) {
+            std::memmove(mBuffer.get(), mBuffer.get() + mIndex, mEnd - mIndex);
+            mEnd -= mIndex;
+            mIndex = 0;
+        }
+        if (mEnd == mBufSize) [[unlikely]] {
+            co_return false;
+        }
+        StopToken token = co_await get_stop_token();
+        token.throw_if_stop_requested();
+        auto *that = static_cast<Reader *>(this);
+        auto len = co_await that->read(
+            std::span(mBuffer.get() + mEnd, mBufSize - mEnd));
+        if (len == 0) [[unlikely]] {
+            throw EOFException();
+        }
+        mEnd += len;
+        co_return true;
+    }
+
+    // try_ 系列不抛出异常：对端关闭时返回 StreamError::EndOfFile，
+    // 系统调用失败时返回其错误码。Reader 提供 read_expected 时经由它读取，
+    // 否则调用 read，其抛出的异常在这一层转为错误码
+
+    // 读取至少一个字节，先取缓冲区中已有的内容
+    Task<Expected<std::size_t>> try_read(std::span<char> buffer) {
+        if (bufferEmpty()) {
+            if (auto res = co_await tryFillBuffer(); !res) [[unlikely]] {
+                co_return res.error();
+            }
+        }
+        std::size_t n = std::min(buffer.size(), mEnd - mIndex);
+        std::memcpy(buffer.data(), mBuffer.get() + mIndex, n);
+        mIndex += n;
+        co_return n;
+    }
+
+    // 在缓冲区中整块查找 eol，而不是逐个字符 co_await；
+    // 与 getline 相同，最后一行没有 eol 时返回 EndOfFile
+    Task<Expected<std::string>> try_getline(char eol = '\n') {
+        std::string s;
+        while (true) {
+            char *begin = mBuffer.get() + mIndex;
+            char *end = mBuffer.get() + mEnd;
+            if (auto *p = static_cast<char *>(
+                    std::memchr(begin, eol, end - begin))) {
+                s.append(begin, p);
+                mIndex += p - begin + 1;
+                co_return std::move(s);
+            }
+            s.append(begin, end);
+            mIndex = mEnd;
+            if (auto res = co_await tryFillBuffer(); !res) [[unlikely]] {
+                co_return res.error();
+            }
+        }
+    }
+
+    // 已读入缓冲区、尚未被取走的字节数
+    std::size_t buffered() const noexcept {
+        return mEnd - mIndex;
+    }
+
 private:
     bool bufferEmpty() const noexcept {
         return mIndex == mEnd;
     }
 
+    // 读写前检查 StopToken，不经过事件循环的 Reader / Writer 也能及时中止
     Task<> fillBuffer() {
+        StopToken token = co_await get_stop_token();
+        token.throw_if_stop_requested();
         auto *that = static_cast<Reader *>(this);
         mEnd = co_await that->read(std::span(mBuffer.get(), mBufSize));
         mIndex = 0;
@@ -92,6 +172,31 @@ private:
         }
     }
 
+    Task<Expected<>> tryFillBuffer() {
+        StopToken token = co_await get_stop_token();
+        if (token.stop_requested()) [[unlikely]] {
+            co_return std::make_error_code(std::errc::operation_canceled);
+        }
+        auto *that = static_cast<Reader *>(this);
+        auto buffer = std::span(mBuffer.get(), mBufSize);
+        std::size_t len;
+        if constexpr (requires { that->read_expected(buffer); }) {
+            auto res = co_await that->read_expected(buffer);
+            if (!res) [[unlikely]] {
+                co_return res.error();
+            }
+            len = *res;
+        } else {
+            len = co_await that->read(buffer);
+        }
+        mEnd = len;
+        mIndex = 0;
+        if (len == 0) [[unlikely]] {
+            co_return StreamError::EndOfFile;
+        }
+        co_return Expected<>();
+    }
+
     std::unique_ptr<char[]> mBuffer;
     std::size_t mIndex = 0;
     std::size_t mEnd = 0;
@@ -116,13 +221,21 @@ struct OStreamBase {
     }
 
     Task<> puts(std::string_view s) {
-        for (char c: s) {
-            co_await putchar(c);
+        while (!s.empty()) {
+            if (bufferFull()) {
+                co_await flush();
+            }
+            std::size_t n = std::min(s.size(), mBufSize - mIndex);
+            std::memcpy(mBuffer.get() + mIndex, s.data(), n);
+            mIndex += n;
+            s.remove_prefix(n);
         }
     }
 
     Task<> flush() {
         if (mIndex) [[likely]] {
+            StopToken token = co_await get_stop_token();
+            token.throw_if_stop_requested();
             auto *that = static_cast<Writer *>(this);
             auto buf = std::span(mBuffer.get(), mIndex);
             auto len = co_await that->write(buf);
@@ -137,6 +250,68 @@ struct OStreamBase {
         }
     }
 
+    // 不抛出的 puts 与 flush，错误的含义同 IStreamBase::try_read
+    Task<Expected<>> try_puts(std::string_view s) {
+        while (!s.empty()) {
+            if (bufferFull()) {
+                if (auto res = co_await try_flush(); !res) [[unlikely]] {
+                    co_return res;
+                }
+            }
+            std::size_t n = std::min(s.size(), mBufSize - mIndex);
+            std::memcpy(mBuffer.get() + mIndex, s.data(), n);
+            mIndex += n;
+            s.remove_prefix(n);
+        }
+        co_return Expected<>();
+    }
+
+    // 中途出错时已写出的部分从缓冲区移除，重试时只发送余下的内容
+    Task<Expected<>> try_flush() {
+        StopToken token = co_await get_stop_token();
+        if (token.stop_requested()) [[unlikely]] {
+            co_return std::make_error_code(std::errc::operation_canceled);
+        }
+        auto *that = static_cast<Writer *>(this);
+        std::size_t written = 0;
+        Expected<> res;
+        while (written != mIndex) {
+            auto buf = std::span<char const>(mBuffer.get() + written,
+                                             mIndex - written);
+            std::size_t len;
+            if constexpr (requires { that->write_expected(buf); }) {
+                auto ret = co_await that->write_expected(buf);
+                if (!ret) [[unlikely]] {
+                    res = ret.error();
+                    break;
+                }
+                len = *ret;
+            } else {
+                // 取消等异常也要先记下已写出的部分，不能直接交给 promise
+                try {
+                    len = co_await that->write(buf);
+                } catch (EOFException const &) {
+                    res = StreamError::EndOfFile;
+                    break;
+                } catch (std::system_error const &e) {
+                    res = e.code();
+                    break;
+                }
+            }
+            if (len == 0) [[unlikely]] {
+                res = StreamError::EndOfFile;
+                break;
+            }
+            written += len;
+        }
+        if (written != 0) {
+            std::memmove(mBuffer.get(), mBuffer.get() + written,
+                         mIndex - written);
+            mIndex -= written;
+        }
+        co_return res;
+    }
+
 private:
     bool bufferFull() const noexcept {
         return mIndex == mBufSize;
@@ -177,7 +352,7 @@ struct [[nodiscard]] OStream : OStreamBase<OStream<StreamBuf>>, StreamBuf {
 };
 
 template <class StreamBuf>
-struct [[nodiscard]] IStream : IStreamBase<OStream<StreamBuf>>, StreamBuf {
+struct [[nodiscard]] IStream : IStreamBase<IStream<StreamBuf>>, StreamBuf {
     template <class... Args>
         requires std::constructible_from<StreamBuf, Args...>
     explicit IStream(Args &&...args)
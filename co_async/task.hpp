@@ -6,6 +6,7 @@
 #include <utility>
 #include <co_async/uninitialized.hpp>
 #include <co_async/previous_awaiter.hpp>
+#include <co_async/stop_token.hpp>
 
 namespace co_async {
 
@@ -16,7 +17,7 @@ struct Promise {
     }
 
     auto final_suspend() noexcept {
-        return PreviousAwaiter(mPrevious);
+        return PreviousAwaiter(mPrevious, mHook);
     }
 
     void unhandled_exception() noexcept {
@@ -43,8 +44,10 @@ struct Promise {
     }
 
     std::coroutine_handle<> mPrevious;
+    CompletionHook *mHook = nullptr;
     std::exception_ptr mException{};
     Uninitialized<T> mResult; // destructed??
+    StopToken mStopToken{};
 
     Promise &operator=(Promise &&) = delete;
 };
@@ -56,7 +59,7 @@ struct Promise<void> {
     }
 
     auto final_suspend() noexcept {
-        return PreviousAwaiter(mPrevious);
+        return PreviousAwaiter(mPrevious, mHook);
     }
 
     void unhandled_exception() noexcept {
@@ -76,7 +79,9 @@ struct Promise<void> {
     }
 
     std::coroutine_handle<> mPrevious;
+    CompletionHook *mHook = nullptr;
     std::exception_ptr mException{};
+    StopToken mStopToken{};
 
     Promise &operator=(Promise &&) = delete;
 };
@@ -94,6 +99,7 @@ struct [[nodiscard]] Task {
 
     Task &operator=(Task &&that) noexcept {
         std::swap(mCoroutine, that.mCoroutine);
+        return *this;
     }
 
     ~Task() {
@@ -106,10 +112,12 @@ struct [[nodiscard]] Task {
             return false;
         }
 
+        template <class Q>
         std::coroutine_handle<promise_type>
-        await_suspend(std::coroutine_handle<> coroutine) const noexcept {
+        await_suspend(std::coroutine_handle<Q> coroutine) const noexcept {
             promise_type &promise = mCoroutine.promise();
             promise.mPrevious = coroutine;
+            inherit_stop_token(stopTokenOf(coroutine));
             return mCoroutine;
         }
 
@@ -117,6 +125,34 @@ struct [[nodiscard]] Task {
             return mCoroutine.promise().result();
         }
 
+        // 由组合器直接启动，任务结束时调用 hook 而不是恢复等待者；
+        // 返回任务的协程，由调用者恢复
+        std::coroutine_handle<> await_hook(CompletionHook *hook) const noexcept
+            requires requires(promise_type &promise) { promise.mHook; }
+        {
+            mCoroutine.promise().mHook = hook;
+            return mCoroutine;
+        }
+
+        // 等待者不再关心结果，任务结束时不恢复任何协程
+        void detach() const noexcept {
+            promise_type &promise = mCoroutine.promise();
+            promise.mPrevious = std::noop_coroutine();
+            if constexpr (requires { promise.mHook; }) {
+                promise.mHook = nullptr;
+            }
+        }
+
+        // 子任务沿用等待者的 StopToken，除非已经用 set_stop_token 指定
+        void inherit_stop_token(StopToken token) const noexcept {
+            promise_type &promise = mCoroutine.promise();
+            if constexpr (requires { promise.mStopToken; }) {
+                if (!promise.mStopToken.stop_possible()) {
+                    promise.mStopToken = token;
+                }
+            }
+        }
+
         std::coroutine_handle<promise_type> mCoroutine;
     };
 
@@ -124,6 +160,11 @@ struct [[nodiscard]] Task {
         return Awaiter(mCoroutine);
     }
 
+    // 作为一棵任务树的根，其中等待的子任务都沿用这个 StopToken
+    void set_stop_token(StopToken token) const noexcept {
+        mCoroutine.promise().mStopToken = token;
+    }
+
     operator std::coroutine_handle<promise_type>() const noexcept {
         return mCoroutine;
     }
@@ -135,7 +176,7 @@ private:
 template <class Loop, class T, class P>
 T run_task(Loop &loop, Task<T, P> const &t) {
     auto a = t.operator co_await();
-    a.await_suspend(std::noop_coroutine()).resume();
+    ReadyQueue::current().resume(a.await_suspend(std::noop_coroutine()));
     loop.run();
     return a.await_resume();
 };
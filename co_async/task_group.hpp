@@ -0,0 +1,266 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <co_async/stop_token.hpp>
+#include <co_async/task.hpp>
+#include <co_async/when_child.hpp>
+
+namespace co_async {
+
+// 结构化并发的任务组：spawn 在并发数达到上限时挂起，等有任务结束再启动；
+// 任一任务抛出异常即取消 (销毁) 其余正在运行的任务；join 等待全部结束，
+// 按 spawn 的顺序返回结果或重新抛出最先的异常，之后任务组可以继续使用。
+// 结果保存到 join 为止，任务本身的协程帧在结束时即释放，节点随之回收，
+// 因此从不 join 的 TaskGroup<> 占用的内存只取决于同时运行的任务数。
+// 任务沿用 spawn 它的协程的 StopToken，与 when_all 的子任务相同
+template <class T = void>
+struct TaskGroup {
+    explicit TaskGroup(std::size_t maxConcurrency =
+                           std::numeric_limits<std::size_t>::max()) noexcept
+        : mLimit(maxConcurrency ? maxConcurrency : 1) {
+        mWaiters.mPrev = mWaiters.mNext = &mWaiters;
+    }
+
+    TaskGroup(TaskGroup &&) = delete;
+
+    struct WaiterNode {
+        WaiterNode *mPrev{};
+        WaiterNode *mNext{};
+
+        void unlink() noexcept {
+            if (mPrev) {
+                mPrev->mNext = mNext;
+                mNext->mPrev = mPrev;
+                mPrev = mNext = nullptr;
+            }
+        }
+    };
+
+    // 等待名额的 spawn，节点存放在等待者的协程帧里，帧销毁时自动摘除；
+    // 总是进入 await_suspend 以取得等待者的 StopToken，有名额时不挂起
+    struct [[nodiscard]] SpawnAwaiter : WaiterNode {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        template <class P>
+        bool await_suspend(std::coroutine_handle<P> coroutine) noexcept {
+            mToken = stopTokenOf(coroutine);
+            if (mGroup.mException ||
+                (mGroup.mRunning < mGroup.mLimit &&
+                 mGroup.mWaiters.mNext == &mGroup.mWaiters)) {
+                return false;
+            }
+            mCoroutine = coroutine;
+            this->mPrev = mGroup.mWaiters.mPrev;
+            this->mNext = &mGroup.mWaiters;
+            this->mPrev->mNext = this;
+            this->mNext->mPrev = this;
+            return true;
+        }
+
+        // 返回 false 表示任务组已因异常取消，任务未启动
+        bool await_resume() {
+            if (mGroup.mException) {
+                return false;
+            }
+            mGroup.start(std::move(mTask), mToken);
+            return true;
+        }
+
+        SpawnAwaiter(TaskGroup &group, Task<T> &&task) noexcept
+            : mGroup(group),
+              mTask(std::move(task)) {}
+
+        SpawnAwaiter(SpawnAwaiter &&) = delete;
+
+        ~SpawnAwaiter() {
+            this->unlink();
+        }
+
+        TaskGroup &mGroup;
+        Task<T> mTask;
+        StopToken mToken{};
+        std::coroutine_handle<> mCoroutine{};
+    };
+
+    struct [[nodiscard]] JoinAwaiter {
+        bool await_ready() const noexcept {
+            return mGroup.mRunning == 0;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            mGroup.mJoiner = coroutine;
+        }
+
+        auto await_resume() {
+            return mGroup.collect();
+        }
+
+        TaskGroup &mGroup;
+    };
+
+    SpawnAwaiter spawn(Task<T> task) noexcept {
+        return SpawnAwaiter(*this, std::move(task));
+    }
+
+    JoinAwaiter join() noexcept {
+        return JoinAwaiter(*this);
+    }
+
+    std::size_t running() const noexcept {
+        return mRunning;
+    }
+
+    // 由 WhenChild 在任务结束时调用，返回需要恢复的协程
+    std::coroutine_handle<> complete(std::size_t index) noexcept {
+        --mRunning;
+        Node &node = mNodes[index];
+        // 结果已经取出，及早释放协程帧
+        node.mTask = Task<T>();
+        if (auto &result = node.mChild.mResult) {
+            if constexpr (kKeepResults) {
+                mResults[node.mSlot].emplace(std::move(*result));
+            }
+            result.reset();
+        }
+        release(index);
+        std::coroutine_handle<> next = nullptr;
+        if (mException && !mCancelled) {
+            cancel();
+            // 等待名额的 spawn 都会得到 false，只留最后一个交给调用者恢复
+            while (mWaiters.mNext != &mWaiters) {
+                auto *waiter = static_cast<SpawnAwaiter *>(mWaiters.mNext);
+                waiter->unlink();
+                if (next) {
+                    next.resume();
+                }
+                next = waiter->mCoroutine;
+            }
+            if (mJoiner) {
+                if (next) {
+                    next.resume();
+                }
+                next = std::exchange(mJoiner, nullptr);
+            }
+        } else if (mWaiters.mNext != &mWaiters) {
+            auto *waiter = static_cast<SpawnAwaiter *>(mWaiters.mNext);
+            waiter->unlink();
+            next = waiter->mCoroutine;
+        } else if (mRunning == 0) {
+            next = std::exchange(mJoiner, nullptr);
+        }
+        if (mStarting) {
+            // 任务在 start 中同步结束，由 start 返回后再恢复
+            mDeferred = next;
+            return nullptr;
+        }
+        return next;
+    }
+
+    std::exception_ptr mException{};
+
+private:
+    static constexpr bool kKeepResults = !std::is_void_v<T>;
+    static constexpr std::size_t kNoNode = std::size_t(-1);
+
+    struct Node {
+        Task<T> mTask;
+        WhenChild<Task<T>, TaskGroup> mChild;
+        std::size_t mSlot{};                // 结果在 mResults 中的下标
+        std::size_t mNextFree{kNoNode};     // 空闲链表中的下一个节点
+    };
+
+    // 优先重用已结束任务的节点
+    std::size_t acquire() {
+        if (mFree == kNoNode) {
+            mNodes.emplace_back();
+            return mNodes.size() - 1;
+        }
+        return std::exchange(mFree, mNodes[mFree].mNextFree);
+    }
+
+    void release(std::size_t index) noexcept {
+        mNodes[index].mNextFree = std::exchange(mFree, index);
+    }
+
+    void start(Task<T> &&task, StopToken token) {
+        std::size_t slot = 0;
+        if constexpr (kKeepResults) {
+            slot = mResults.size();
+            mResults.emplace_back();
+        }
+        std::size_t index = acquire();
+        Node &node = mNodes[index];
+        node.mSlot = slot;
+        node.mTask = std::move(task);
+        ++mRunning;
+        // 被恢复的 spawn 可能在另一个任务的 start 中再次调用 start
+        bool starting = std::exchange(mStarting, true);
+        node.mChild.start(node.mTask, *this, index, token);
+        mStarting = starting;
+        if (auto next = std::exchange(mDeferred, nullptr)) {
+            next.resume();
+        }
+    }
+
+    void cancel() noexcept {
+        mCancelled = true;
+        for (std::size_t i = 0; i < mNodes.size(); ++i) {
+            Node &node = mNodes[i];
+            if (node.mChild.pending()) {
+                node.mChild.forget();
+                node.mTask = Task<T>();
+                --mRunning;
+                release(i);
+            }
+        }
+    }
+
+    auto collect() {
+        auto e = std::exchange(mException, nullptr);
+        mCancelled = false;
+        if constexpr (!kKeepResults) {
+            if (e) [[unlikely]] {
+                std::rethrow_exception(e);
+            }
+        } else {
+            auto results = std::exchange(mResults, {});
+            if (e) [[unlikely]] {
+                std::rethrow_exception(e);
+            }
+            std::vector<T> res;
+            res.reserve(results.size());
+            for (auto &result: results) {
+                res.push_back(std::move(*result));
+            }
+            return res;
+        }
+    }
+
+    std::size_t mLimit;
+    std::size_t mRunning = 0;
+    bool mCancelled = false;
+    bool mStarting = false;
+    std::coroutine_handle<> mDeferred{};
+    std::coroutine_handle<> mJoiner{};
+    WaiterNode mWaiters;
+    // deque 在尾部追加时不移动已有元素，子任务结束时经由下标找到节点
+    std::deque<Node> mNodes;
+    std::size_t mFree = kNoNode;
+    // 按 spawn 的顺序保存非 void 任务的结果，join 时取走
+    std::conditional_t<kKeepResults,
+                       std::vector<std::optional<typename WhenResult<T>::Type>>,
+                       NonVoidHelper<>>
+        mResults;
+};
+
+} // namespace co_async
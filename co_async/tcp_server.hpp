@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <co_async/task.hpp>
+#include <co_async/epoll_loop.hpp>
+#include <co_async/socket.hpp>
+#include <co_async/stop_token.hpp>
+#include <co_async/stream.hpp>
+#include <co_async/wait_queue.hpp>
+
+namespace co_async {
+
+struct TcpServer;
+
+// 每个连接一个自行销毁的协程，结束时归还连接名额
+struct ConnectionPromise {
+    auto initial_suspend() noexcept {
+        return std::suspend_always();
+    }
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        inline std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<ConnectionPromise> coroutine)
+            const noexcept;
+
+        void await_resume() const noexcept {}
+    };
+
+    auto final_suspend() noexcept {
+        return FinalAwaiter();
+    }
+
+    void unhandled_exception() noexcept {
+        mException = std::current_exception();
+    }
+
+    void return_void() noexcept {}
+
+    auto get_return_object() {
+        return std::coroutine_handle<ConnectionPromise>::from_promise(*this);
+    }
+
+    TcpServer *mServer{};
+    std::exception_ptr mException{};
+    StopToken mStopToken{};
+
+    ConnectionPromise &operator=(ConnectionPromise &&) = delete;
+};
+
+struct TcpServer {
+    static constexpr std::size_t kUnlimited = std::size_t(-1);
+
+    explicit TcpServer(EpollLoop &loop, AsyncFile &&listener,
+                       std::size_t maxConnections = kUnlimited,
+                       std::size_t acceptBatch = 64)
+        : mLoop(loop),
+          mListener(std::move(listener)),
+          mMaxConnections(maxConnections),
+          mAcceptBatch(acceptBatch) {}
+
+    TcpServer &operator=(TcpServer &&) = delete;
+
+    std::size_t activeConnections() const noexcept {
+        return mActive;
+    }
+
+    std::size_t acceptedConnections() const noexcept {
+        return mAccepted;
+    }
+
+    AsyncFile &listener() noexcept {
+        return mListener;
+    }
+
+    // 连接处理协程逃出的异常交给 handler，在连接结束时调用，不得抛出；
+    // 未设置时打印到 stderr。对端关闭 (EOFException) 与 stop 引起的
+    // 取消属于正常结束，不会上报
+    void on_error(std::function<void(std::exception_ptr)> handler) {
+        mOnError = std::move(handler);
+    }
+
+    // handler(FileStream &, SocketAddress const &) -> Task<>；
+    // stop 之后 serve 返回，不等待连接结束
+    template <class Handler>
+    Task<> serve(Handler handler) {
+        std::vector<std::tuple<AsyncFile, SocketAddress>> batch;
+        batch.reserve(mAcceptBatch);
+        while (!mStopSource.stop_requested()) {
+            if (mActive >= mMaxConnections) {
+                // 连接数已满，不再 accept，让内核 backlog 承担背压
+                co_await SlotAwaiter(this);
+                continue;
+            }
+            std::size_t quota =
+                std::min(mAcceptBatch, mMaxConnections - mActive);
+            auto accept = socket_accept_batch(mLoop, mListener, batch, quota);
+            accept.set_stop_token(mStopSource.get_token());
+            try {
+                co_await accept;
+            } catch (...) {
+                if (!mStopSource.stop_requested()) {
+                    throw;
+                }
+            }
+            if (mStopSource.stop_requested()) {
+                break;
+            }
+            for (auto &[file, addr]: batch) {
+                spawn(handler, std::move(file), addr);
+            }
+            batch.clear();
+        }
+    }
+
+    // 停止接受连接，并让所有连接中的处理协程 (包括其等待的子任务)
+    // 在等待 I/O 或定时器处抛出 errc::operation_canceled 退出，
+    // 连接随之关闭、协程帧随之释放
+    void stop() {
+        // 等待名额的 serve 经 ReadyQueue 恢复，不在 stop 中嵌套恢复：
+        // serve 返回后调用者可能随即销毁本对象或调用 stop 的协程
+        auto *acceptor = std::exchange(mAcceptor, nullptr);
+        if (mStopSource.request_stop() && acceptor) {
+            ReadyQueue::current().wake(acceptor);
+        }
+    }
+
+private:
+    friend struct ConnectionPromise;
+
+    struct SlotAwaiter : WaitQueueNode {
+        explicit SlotAwaiter(TcpServer *server) noexcept : mServer(server) {}
+
+        SlotAwaiter(SlotAwaiter &&) = delete;
+
+        // serve 的协程在等待或排队期间被销毁时摘下
+        ~SlotAwaiter() {
+            if (mServer->mAcceptor == this) {
+                mServer->mAcceptor = nullptr;
+            }
+            this->unlink();
+        }
+
+        bool await_ready() const noexcept {
+            return mServer->mActive < mServer->mMaxConnections;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            this->mCoroutine = coroutine;
+            mServer->mAcceptor = this;
+        }
+
+        void await_resume() const noexcept {}
+
+        TcpServer *mServer;
+    };
+
+    struct ConnectionTask {
+        using promise_type = ConnectionPromise;
+
+        ConnectionTask(std::coroutine_handle<promise_type> coroutine) noexcept
+            : mCoroutine(coroutine) {}
+
+        std::coroutine_handle<promise_type> mCoroutine;
+    };
+
+    template <class Handler>
+    static ConnectionTask connectionMain(Handler &handler, FileStream stream,
+                                         SocketAddress addr) {
+        co_await handler(stream, std::as_const(addr));
+    }
+
+    template <class Handler>
+    void spawn(Handler &handler, AsyncFile &&file, SocketAddress const &addr) {
+        auto coroutine =
+            connectionMain(handler, FileStream(mLoop, std::move(file)), addr)
+                .mCoroutine;
+        coroutine.promise().mServer = this;
+        coroutine.promise().mStopToken = mStopSource.get_token();
+        ++mActive;
+        ++mAccepted;
+        coroutine.resume();
+    }
+
+    static void reportError(std::exception_ptr e) noexcept {
+        try {
+            std::rethrow_exception(e);
+        } catch (std::exception const &err) {
+            std::cerr << "co_async: connection handler: " << err.what()
+                      << '\n';
+        } catch (...) {
+            std::cerr << "co_async: connection handler: unknown exception\n";
+        }
+    }
+
+    void handleError(std::exception_ptr e) noexcept {
+        try {
+            std::rethrow_exception(e);
+        } catch (EOFException const &) {
+            return;
+        } catch (std::system_error const &err) {
+            if (err.code() == std::errc::operation_canceled &&
+                mStopSource.stop_requested()) {
+                return;
+            }
+        } catch (...) {
+        }
+        if (mOnError) {
+            mOnError(std::move(e));
+        } else {
+            reportError(std::move(e));
+        }
+    }
+
+    std::coroutine_handle<> releaseConnection(std::exception_ptr e) noexcept {
+        if (e) [[unlikely]] {
+            handleError(std::move(e));
+        }
+        --mActive;
+        if (mAcceptor && mActive < mMaxConnections) {
+            return std::exchange(mAcceptor, nullptr)->mCoroutine;
+        }
+        return std::noop_coroutine();
+    }
+
+    EpollLoop &mLoop;
+    AsyncFile mListener;
+    std::size_t mMaxConnections;
+    std::size_t mAcceptBatch;
+    std::size_t mActive = 0;
+    std::size_t mAccepted = 0;
+    WaitQueueNode *mAcceptor{};
+    std::function<void(std::exception_ptr)> mOnError;
+    StopSource mStopSource;
+};
+
+std::coroutine_handle<> ConnectionPromise::FinalAwaiter::await_suspend(
+    std::coroutine_handle<ConnectionPromise> coroutine) const noexcept {
+    TcpServer *server = coroutine.promise().mServer;
+    auto e = std::move(coroutine.promise().mException);
+    coroutine.destroy();
+    return server->releaseConnection(std::move(e));
+}
+
+} // namespace co_async
@@ -5,6 +5,7 @@
 #include <optional>
 #include <co_async/task.hpp>
 #include <co_async/rbtree.hpp>
+#include <co_async/stop_token.hpp>
 
 namespace co_async {
 
@@ -41,8 +42,9 @@ struct TimerLoop {
             auto &promise = mRbTimer.front();
             if (promise.mExpireTime < nowTime) {
                 mRbTimer.erase(promise);
-                std::coroutine_handle<SleepUntilPromise>::from_promise(promise)
-                    .resume();
+                ReadyQueue::current().resume(
+                    std::coroutine_handle<SleepUntilPromise>::from_promise(
+                        promise));
             } else {
                 return promise.mExpireTime - nowTime;
             }
@@ -53,24 +55,54 @@ struct TimerLoop {
     TimerLoop &operator=(TimerLoop &&) = delete;
 };
 
-struct SleepAwaiter {
+// 请求停止时从定时器中摘下，经 ReadyQueue 恢复，await_resume 随之抛出
+struct SleepAwaiter : StopCallbackNode {
+    using ClockType = std::chrono::system_clock;
+
+    SleepAwaiter(TimerLoop &loop, ClockType::time_point expireTime)
+        : StopCallbackNode(&SleepAwaiter::onStop),
+          mLoop(loop),
+          mExpireTime(expireTime) {}
+
     bool await_ready() const noexcept {
         return false;
     }
 
-    void
-    await_suspend(std::coroutine_handle<SleepUntilPromise> coroutine) const {
+    bool await_suspend(std::coroutine_handle<SleepUntilPromise> coroutine) {
         auto &promise = coroutine.promise();
+        if (promise.mStopToken.stop_requested()) [[unlikely]] {
+            mStopped = true;
+            return false;
+        }
         promise.mExpireTime = mExpireTime;
         mLoop.addTimer(promise);
+        this->mCoroutine = coroutine;
+        promise.mStopToken.attach(*this);
+        return true;
     }
 
-    void await_resume() const noexcept {}
-
-    using ClockType = std::chrono::system_clock;
+    void await_resume() {
+        this->unlink();
+        if (mStopped) [[unlikely]] {
+            throwOperationCanceled();
+        }
+    }
 
     TimerLoop &mLoop;
     ClockType::time_point mExpireTime;
+    bool mStopped = false;
+
+private:
+    // 不在 request_stop 中嵌套恢复：调用者可能正是随后要销毁本协程的
+    // 组合器中的子任务；排队期间协程被销毁时节点随本对象析构摘下
+    static void onStop(StopCallbackNode &node) {
+        auto &self = static_cast<SleepAwaiter &>(node);
+        auto coroutine = std::coroutine_handle<SleepUntilPromise>::from_address(
+            self.mCoroutine.address());
+        self.mLoop.mRbTimer.erase(coroutine.promise());
+        self.mStopped = true;
+        ReadyQueue::current().wake(&self);
+    }
 };
 
 template <class Clock, class Dur>
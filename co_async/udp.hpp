@@ -0,0 +1,237 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <co_async/task.hpp>
+#include <co_async/epoll_loop.hpp>
+#include <co_async/socket.hpp>
+#include <co_async/error_handling.hpp>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+namespace co_async {
+
+// 预分配的一批数据报缓冲区，供 recvmmsg/sendmmsg 直接使用
+struct UdpBatch {
+    // 开启 GRO 后内核合并出的负载最长可达 64 KiB，缓冲区应取这么大
+    static constexpr std::size_t kGroBufferSize = 65536;
+
+    explicit UdpBatch(std::size_t count, std::size_t bufferSize = 2048)
+        : mBuffer(std::make_unique<char[]>(count * bufferSize)),
+          mControl(std::make_unique<char[]>(count * kControlSize)),
+          mBufSize(bufferSize),
+          mMsgs(count),
+          mIovecs(count),
+          mAddrs(count),
+          mSegments(count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            mIovecs[i].iov_base = mBuffer.get() + i * mBufSize;
+        }
+    }
+
+    UdpBatch(UdpBatch &&) = default;
+    UdpBatch &operator=(UdpBatch &&) = default;
+
+    std::size_t capacity() const noexcept {
+        return mMsgs.size();
+    }
+
+    std::size_t size() const noexcept {
+        return mSize;
+    }
+
+    bool full() const noexcept {
+        return mSize == mMsgs.size();
+    }
+
+    void clear() noexcept {
+        mSize = 0;
+    }
+
+    std::size_t bufferSize() const noexcept {
+        return mBufSize;
+    }
+
+    std::span<char const> data(std::size_t i) const noexcept {
+        return {mBuffer.get() + i * mBufSize, mIovecs[i].iov_len};
+    }
+
+    SocketAddress const &address(std::size_t i) const noexcept {
+        return mAddrs[i];
+    }
+
+    // 开启 GRO 时，一个缓冲区可能包含多个长度为 segmentSize 的数据报
+    std::size_t segmentSize(std::size_t i) const noexcept {
+        return mSegments[i] ? mSegments[i] : mIovecs[i].iov_len;
+    }
+
+    // 收到的数据报 (或 GRO 合并后的负载) 超出缓冲区，超出部分已被丢弃
+    bool truncated(std::size_t i) const noexcept {
+        return mMsgs[i].msg_hdr.msg_flags & MSG_TRUNC;
+    }
+
+    bool push(std::span<char const> payload, SocketAddress const &addr) {
+        if (full() || payload.size() > mBufSize) [[unlikely]] {
+            return false;
+        }
+        std::memcpy(mBuffer.get() + mSize * mBufSize, payload.data(),
+                    payload.size());
+        mIovecs[mSize].iov_len = payload.size();
+        mAddrs[mSize] = addr;
+        mSegments[mSize] = 0;
+        mMsgs[mSize].msg_hdr.msg_flags = 0;
+        ++mSize;
+        return true;
+    }
+
+private:
+    friend inline std::size_t udpRecvBatchSync(AsyncFile &sock,
+                                               UdpBatch &batch);
+    friend inline std::size_t udpSendBatchSync(AsyncFile &sock,
+                                               UdpBatch &batch,
+                                               std::size_t offset);
+
+    static constexpr std::size_t kControlSize =
+        CMSG_SPACE(sizeof(int));
+
+    void prepareRecv() noexcept {
+        for (std::size_t i = 0; i < mMsgs.size(); ++i) {
+            auto &hdr = mMsgs[i].msg_hdr;
+            mIovecs[i].iov_len = mBufSize;
+            mAddrs[i].mAddrLen = sizeof(mAddrs[i].mAddr);
+            hdr.msg_name = &mAddrs[i].mAddr;
+            hdr.msg_namelen = mAddrs[i].mAddrLen;
+            hdr.msg_iov = &mIovecs[i];
+            hdr.msg_iovlen = 1;
+            hdr.msg_control = mControl.get() + i * kControlSize;
+            hdr.msg_controllen = kControlSize;
+            hdr.msg_flags = 0;
+            mMsgs[i].msg_len = 0;
+        }
+    }
+
+    void finishRecv(std::size_t count) noexcept {
+        for (std::size_t i = 0; i < count; ++i) {
+            auto &hdr = mMsgs[i].msg_hdr;
+            mIovecs[i].iov_len = mMsgs[i].msg_len;
+            mAddrs[i].mAddrLen = hdr.msg_namelen;
+            mSegments[i] = 0;
+            for (cmsghdr *cm = CMSG_FIRSTHDR(&hdr); cm;
+                 cm = CMSG_NXTHDR(&hdr, cm)) {
+                if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+                    int gso;
+                    std::memcpy(&gso, CMSG_DATA(cm), sizeof(gso));
+                    mSegments[i] = (std::uint16_t)gso;
+                }
+            }
+        }
+        mSize = count;
+    }
+
+    void prepareSend() noexcept {
+        for (std::size_t i = 0; i < mSize; ++i) {
+            auto &hdr = mMsgs[i].msg_hdr;
+            hdr.msg_name = &mAddrs[i].mAddr;
+            hdr.msg_namelen = mAddrs[i].mAddrLen;
+            hdr.msg_iov = &mIovecs[i];
+            hdr.msg_iovlen = 1;
+            hdr.msg_control = nullptr;
+            hdr.msg_controllen = 0;
+            hdr.msg_flags = 0;
+        }
+    }
+
+    std::unique_ptr<char[]> mBuffer;
+    std::unique_ptr<char[]> mControl;
+    std::size_t mBufSize;
+    std::vector<mmsghdr> mMsgs;
+    std::vector<iovec> mIovecs;
+    std::vector<SocketAddress> mAddrs;
+    std::vector<std::uint16_t> mSegments;
+    std::size_t mSize = 0;
+};
+
+inline std::size_t udpRecvBatchSync(AsyncFile &sock, UdpBatch &batch) {
+    batch.prepareRecv();
+    int res = checkErrorNonBlock(recvmmsg(sock.fileNo(), batch.mMsgs.data(),
+                                          batch.mMsgs.size(), MSG_DONTWAIT,
+                                          nullptr),
+                                 -1, EAGAIN);
+    if (res == -1) {
+        batch.mSize = 0;
+        return 0;
+    }
+    batch.finishRecv(res);
+    return res;
+}
+
+inline std::size_t udpSendBatchSync(AsyncFile &sock, UdpBatch &batch,
+                                    std::size_t offset) {
+    if (offset == 0) {
+        batch.prepareSend();
+    }
+    int res = checkErrorNonBlock(sendmmsg(sock.fileNo(),
+                                          batch.mMsgs.data() + offset,
+                                          batch.mSize - offset, MSG_DONTWAIT),
+                                 -1, EAGAIN);
+    return res == -1 ? 0 : res;
+}
+
+inline AsyncFile create_udp_server(SocketAddress const &addr) {
+    AsyncFile sock(checkError(socket(addr.mAddr.ss_family, SOCK_DGRAM, 0)));
+    sock.setNonblock();
+    checkError(
+        bind(sock.fileNo(), (sockaddr const *)&addr.mAddr, addr.mAddrLen));
+    return sock;
+}
+
+// 内核按 segmentSize 切分超过该长度的发送负载 (UDP GSO)，0 表示关闭
+inline void udp_set_segment_size(AsyncFile &sock, int segmentSize) {
+    socketSetOption(sock, SOL_UDP, UDP_SEGMENT, segmentSize);
+}
+
+// 内核把同一流的数据报合并后交付，段长通过 UdpBatch::segmentSize 取得；
+// 接收用的 batch 应由 udp_gro_batch 创建，缓冲区过小时负载会被截断
+inline void udp_enable_gro(AsyncFile &sock, bool enable = true) {
+    socketSetOption(sock, SOL_UDP, UDP_GRO, (int)enable);
+}
+
+inline UdpBatch udp_gro_batch(std::size_t count) {
+    return UdpBatch(count, UdpBatch::kGroBufferSize);
+}
+
+// 至少收到一个数据报后返回，一次系统调用最多填满整个 batch
+inline Task<std::size_t> recv_batch(EpollLoop &loop, AsyncFile &sock,
+                                    UdpBatch &batch) {
+    std::size_t count = udpRecvBatchSync(sock, batch);
+    while (count == 0) {
+        co_await wait_file_event(loop, sock, EPOLLIN);
+        count = udpRecvBatchSync(sock, batch);
+    }
+    co_return count;
+}
+
+// 发送 batch 中全部数据报，发送缓冲区满时等待可写
+inline Task<std::size_t> send_batch(EpollLoop &loop, AsyncFile &sock,
+                                    UdpBatch &batch) {
+    std::size_t sent = udpSendBatchSync(sock, batch, 0);
+    while (sent != batch.size()) {
+        co_await wait_file_event(loop, sock, EPOLLOUT);
+        sent += udpSendBatchSync(sock, batch, sent);
+    }
+    co_return sent;
+}
+
+} // namespace co_async
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <utility>
+
+namespace co_async {
+
+// 保护等待队列本身的自旋锁，临界区只有几次指针操作。它只让队列操作
+// 可以从多个线程调用，被唤醒的协程仍在唤醒者的线程上恢复
+struct SpinLock {
+    void lock() noexcept {
+        while (mLocked.exchange(true, std::memory_order_acquire)) {
+            while (mLocked.load(std::memory_order_relaxed)) {
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#endif
+            }
+        }
+    }
+
+    void unlock() noexcept {
+        mLocked.store(false, std::memory_order_release);
+    }
+
+private:
+    std::atomic<bool> mLocked{false};
+};
+
+// 只在一个事件循环内使用时不需要任何同步
+struct NullLock {
+    void lock() noexcept {}
+
+    void unlock() noexcept {}
+};
+
+struct WaitQueueNode {
+    WaitQueueNode *mPrev{};
+    WaitQueueNode *mNext{};
+    std::coroutine_handle<> mCoroutine{};
+    // 已被唤醒、在 ReadyQueue 中等待恢复
+    bool mReady = false;
+
+    void unlink() noexcept {
+        if (mPrev) {
+            mPrev->mNext = mNext;
+            mNext->mPrev = mPrev;
+            mPrev = mNext = nullptr;
+        }
+    }
+};
+
+// 侵入式的先进先出队列，节点存放在等待者的 awaiter 里，入队不分配内存
+struct WaitQueue {
+    WaitQueue() noexcept {
+        mHead.mPrev = mHead.mNext = &mHead;
+    }
+
+    WaitQueue(WaitQueue &&) = delete;
+
+    bool empty() const noexcept {
+        return mHead.mNext == &mHead;
+    }
+
+    void pushBack(WaitQueueNode *node) noexcept {
+        node->mPrev = mHead.mPrev;
+        node->mNext = &mHead;
+        node->mPrev->mNext = node;
+        node->mNext->mPrev = node;
+    }
+
+    WaitQueueNode *popFront() noexcept {
+        if (empty()) {
+            return nullptr;
+        }
+        WaitQueueNode *node = mHead.mNext;
+        node->unlink();
+        return node;
+    }
+
+    // 按入队顺序找到第一个满足 pred 的节点，不摘下
+    template <class F>
+    WaitQueueNode *find(F &&pred) const {
+        for (WaitQueueNode *node = mHead.mNext; node != &mHead;
+             node = node->mNext) {
+            if (pred(node)) {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    // 把 that 中的全部节点按顺序移到本队列末尾
+    void append(WaitQueue &that) noexcept {
+        if (that.empty()) {
+            return;
+        }
+        WaitQueueNode *first = that.mHead.mNext;
+        WaitQueueNode *last = that.mHead.mPrev;
+        that.mHead.mPrev = that.mHead.mNext = &that.mHead;
+        first->mPrev = mHead.mPrev;
+        last->mNext = &mHead;
+        mHead.mPrev->mNext = first;
+        mHead.mPrev = last;
+    }
+
+private:
+    WaitQueueNode mHead;
+};
+
+// 本线程的就绪队列。被唤醒的等待者不在唤醒者的调用栈里嵌套恢复，
+// 而是排在这里：事件循环恢复的协程挂起后依次恢复它们；不在事件循环中时
+// 由最外层的唤醒者当场清空。被恢复者再唤醒别人时只是排队，
+// 调用栈深度不随等待队列的长度增长，唤醒者也不会在自身执行中途被重入
+struct ReadyQueue {
+    static ReadyQueue &current() noexcept {
+        thread_local ReadyQueue queue;
+        return queue;
+    }
+
+    ReadyQueue() = default;
+    ReadyQueue(ReadyQueue &&) = delete;
+
+    // 节点的 mCoroutine 须已设置；恢复前节点仍可被其所在的 awaiter 摘下
+    void wake(WaitQueueNode *node) noexcept {
+        node->mReady = true;
+        mQueue.pushBack(node);
+        if (!mRunning) {
+            mRunning = true;
+            drain();
+            mRunning = false;
+        }
+    }
+
+    // 事件循环经此恢复协程，其间唤醒的等待者在它挂起后才恢复
+    void resume(std::coroutine_handle<> coroutine) noexcept {
+        if (std::exchange(mRunning, true)) {
+            coroutine.resume();
+            return;
+        }
+        coroutine.resume();
+        drain();
+        mRunning = false;
+    }
+
+private:
+    void drain() noexcept {
+        while (WaitQueueNode *node = mQueue.popFront()) {
+            node->mReady = false;
+            auto coroutine = node->mCoroutine;
+            coroutine.resume();
+        }
+    }
+
+    WaitQueue mQueue;
+    bool mRunning = false;
+};
+
+} // namespace co_async
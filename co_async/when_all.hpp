@@ -1,125 +1,210 @@
 #pragma once
 
 #include <coroutine>
-#include <span>
+#include <cstddef>
 #include <exception>
+#include <memory>
 #include <vector>
 #include <tuple>
 #include <type_traits>
-#include <co_async/uninitialized.hpp>
-#include <co_async/task.hpp>
-#include <co_async/return_previous.hpp>
+#include <utility>
 #include <co_async/concepts.hpp>
+#include <co_async/when_child.hpp>
 
 namespace co_async {
 
 struct WhenAllCtlBlock {
-    std::size_t mCount;
-    std::coroutine_handle<> mPrevious{};
+    std::size_t mCount{};
+    WhenContinuation mParent;
     std::exception_ptr mException{};
+
+    // 启动子任务期间 mParent 为空，同步完成的子任务回到启动循环，
+    // 不能在循环中途恢复父协程，否则父协程结束后循环访问已释放的 awaiter；
+    // 父协程只恢复一次，因异常提前恢复后其余子任务的完成不再理会
+    std::coroutine_handle<> complete(std::size_t) noexcept {
+        --mCount;
+        if (done()) {
+            return mParent.take();
+        }
+        return nullptr;
+    }
+
+    bool done() const noexcept {
+        return mCount == 0 || mException;
+    }
 };
 
+// 控制块、子任务的 awaiter 与结果都存放在本对象中，本对象又位于父协程帧里，
+// co_await 时不再分配内存。开始等待前可以移动，如作为参数传给另一个组合器
+template <class... Ts>
 struct WhenAllAwaiter {
+    explicit WhenAllAwaiter(Ts &&...ts) : mTasks(std::forward<Ts>(ts)...) {}
+
+    WhenAllAwaiter(WhenAllAwaiter &&that) : mTasks(std::move(that.mTasks)) {}
+
     bool await_ready() const noexcept {
         return false;
     }
 
-    std::coroutine_handle<>
-    await_suspend(std::coroutine_handle<> coroutine) const {
-        if (mTasks.empty())
-            return coroutine;
-        mControl.mPrevious = coroutine;
-        for (auto const &t: mTasks.subspan(0, mTasks.size() - 1))
-            t.mCoroutine.resume();
-        return mTasks.back().mCoroutine;
+    template <class P>
+    bool await_suspend(std::coroutine_handle<P> coroutine) {
+        inherit_stop_token(stopTokenOf(coroutine));
+        if (launch()) {
+            return false;
+        }
+        mControl.mParent.mPrevious = coroutine;
+        return true;
+    }
+
+    // 作为外层组合器的子任务时由外层启动，结束时调用 hook
+    std::coroutine_handle<> await_hook(CompletionHook *hook) {
+        if (launch()) {
+            return hook->mCallback(*hook);
+        }
+        mControl.mParent.mHook = hook;
+        return std::noop_coroutine();
     }
 
-    void await_resume() const {
+    std::tuple<typename AwaitableTraits<Ts>::NonVoidRetType...>
+    await_resume() {
         if (mControl.mException) [[unlikely]] {
             std::rethrow_exception(mControl.mException);
         }
+        return std::apply(
+            [](auto &...children) {
+                return std::tuple<
+                    typename AwaitableTraits<Ts>::NonVoidRetType...>(
+                    children.moveResult()...);
+            },
+            mChildren);
     }
 
-    WhenAllCtlBlock &mControl;
-    std::span<ReturnPreviousTask const> mTasks;
-};
-
-template <class T>
-ReturnPreviousTask whenAllHelper(auto &&t, WhenAllCtlBlock &control,
-                                 Uninitialized<T> &result) {
-    try {
-        result.putValue(co_await std::forward<decltype(t)>(t));
-    } catch (...) {
-        control.mException = std::current_exception();
-        co_return control.mPrevious;
+    // 本对象作为借用的子任务被外层组合器放弃时调用
+    void detach() noexcept {
+        mControl.mParent.reset();
     }
-    --control.mCount;
-    if (control.mCount == 0) {
-        co_return control.mPrevious;
+
+    // 作为外层组合器的子任务时由外层传入，子任务都沿用这个 StopToken
+    void inherit_stop_token(StopToken token) noexcept {
+        if (!mStopToken.stop_possible()) {
+            mStopToken = token;
+        }
     }
-    co_return std::noop_coroutine();
-}
 
-template <class = void>
-ReturnPreviousTask whenAllHelper(auto &&t, WhenAllCtlBlock &control,
-                                 Uninitialized<void> &) {
-    try {
-        co_await std::forward<decltype(t)>(t);
-    } catch (...) {
-        control.mException = std::current_exception();
-        co_return control.mPrevious;
+private:
+    // 启动全部子任务，返回是否已经结束
+    bool launch() {
+        mControl.mCount = sizeof...(Ts);
+        launch(std::make_index_sequence<sizeof...(Ts)>());
+        return mControl.done();
     }
-    --control.mCount;
-    if (control.mCount == 0) {
-        co_return control.mPrevious;
+
+    template <std::size_t... Is>
+    void launch(std::index_sequence<Is...>) {
+        // 有子任务抛出异常时不再启动后面的
+        (void)((std::get<Is>(mChildren).start(std::get<Is>(mTasks), mControl,
+                                              Is, mStopToken),
+                !mControl.mException) &&
+               ...);
     }
-    co_return std::noop_coroutine();
-}
 
-template <std::size_t... Is, class... Ts>
-Task<std::tuple<typename AwaitableTraits<Ts>::NonVoidRetType...>>
-whenAllImpl(std::index_sequence<Is...>, Ts &&...ts) {
-    WhenAllCtlBlock control{sizeof...(Ts)};
-    std::tuple<Uninitialized<typename AwaitableTraits<Ts>::RetType>...> result;
-    ReturnPreviousTask taskArray[]{
-        whenAllHelper(ts, control, std::get<Is>(result))...};
-    co_await WhenAllAwaiter(control, taskArray);
-    co_return std::tuple<typename AwaitableTraits<Ts>::NonVoidRetType...>(
-        std::get<Is>(result).moveValue()...);
-}
+    std::tuple<Ts...> mTasks;
+    WhenAllCtlBlock mControl;
+    StopToken mStopToken{};
+    std::tuple<WhenChild<std::remove_reference_t<Ts>, WhenAllCtlBlock>...>
+        mChildren;
+};
 
 template <Awaitable... Ts>
     requires(sizeof...(Ts) != 0)
-auto when_all(Ts &&...ts) {
-    return whenAllImpl(std::make_index_sequence<sizeof...(Ts)>{},
-                       std::forward<Ts>(ts)...);
+WhenAllAwaiter<Ts...> when_all(Ts &&...ts) {
+    return WhenAllAwaiter<Ts...>(std::forward<Ts>(ts)...);
 }
 
-template <Awaitable T, class Alloc = std::allocator<T>>
-Task<std::conditional_t<
-    std::same_as<void, typename AwaitableTraits<T>::RetType>,
-    std::vector<typename AwaitableTraits<T>::RetType, Alloc>, void>>
-when_all(std::vector<T, Alloc> const &tasks) {
-    WhenAllCtlBlock control{tasks.size()};
-    Alloc alloc = tasks.get_allocator();
-    std::vector<Uninitialized<typename AwaitableTraits<T>::RetType>, Alloc>
-        result(tasks.size(), alloc);
-    {
-        std::vector<ReturnPreviousTask, Alloc> taskArray(alloc);
-        taskArray.reserve(tasks.size());
-        for (std::size_t i = 0; i < tasks.size(); ++i) {
-            taskArray.push_back(whenAllHelper(tasks[i], control, result[i]));
+// 不多于 N 个子任务时同样不分配内存 (结果 vector 除外)
+template <class T, class Alloc, std::size_t N = 16>
+struct WhenAllVectorAwaiter {
+    using RetType = typename AwaitableTraits<T const>::RetType;
+    using ResultAlloc = typename std::allocator_traits<
+        Alloc>::template rebind_alloc<RetType>;
+
+    explicit WhenAllVectorAwaiter(std::vector<T, Alloc> const &tasks)
+        : mTasks(tasks),
+          mChildren(tasks.size()) {}
+
+    WhenAllVectorAwaiter(WhenAllVectorAwaiter &&that)
+        : mTasks(that.mTasks),
+          mChildren(that.mTasks.size()) {}
+
+    bool await_ready() const noexcept {
+        return mTasks.empty();
+    }
+
+    template <class P>
+    bool await_suspend(std::coroutine_handle<P> coroutine) {
+        inherit_stop_token(stopTokenOf(coroutine));
+        if (launch()) {
+            return false;
+        }
+        mControl.mParent.mPrevious = coroutine;
+        return true;
+    }
+
+    std::coroutine_handle<> await_hook(CompletionHook *hook) {
+        if (launch()) {
+            return hook->mCallback(*hook);
         }
-        co_await WhenAllAwaiter(control, taskArray);
+        mControl.mParent.mHook = hook;
+        return std::noop_coroutine();
     }
-    if constexpr (!std::same_as<void, typename AwaitableTraits<T>::RetType>) {
-        std::vector<typename AwaitableTraits<T>::RetType, Alloc> res(alloc);
-        res.reserve(tasks.size());
-        for (auto &r: result) {
-            res.push_back(r.moveValue());
+
+    auto await_resume() {
+        if (mControl.mException) [[unlikely]] {
+            std::rethrow_exception(mControl.mException);
+        }
+        if constexpr (!std::is_void_v<RetType>) {
+            std::vector<RetType, ResultAlloc> res(
+                ResultAlloc(mTasks.get_allocator()));
+            res.reserve(mTasks.size());
+            for (std::size_t i = 0; i < mTasks.size(); ++i) {
+                res.push_back(mChildren[i].moveResult());
+            }
+            return res;
         }
-        co_return res;
     }
+
+    // 本对象作为借用的子任务被外层组合器放弃时调用
+    void detach() noexcept {
+        mControl.mParent.reset();
+    }
+
+    void inherit_stop_token(StopToken token) noexcept {
+        if (!mStopToken.stop_possible()) {
+            mStopToken = token;
+        }
+    }
+
+private:
+    bool launch() {
+        mControl.mCount = mTasks.size();
+        for (std::size_t i = 0; i < mTasks.size(); ++i) {
+            mChildren[i].start(mTasks[i], mControl, i, mStopToken);
+            if (mControl.mException) {
+                break;
+            }
+        }
+        return mControl.done();
+    }
+
+    std::vector<T, Alloc> const &mTasks;
+    WhenAllCtlBlock mControl;
+    StopToken mStopToken{};
+    WhenChildArray<WhenChild<T const, WhenAllCtlBlock>, N> mChildren;
+};
+
+template <Awaitable T, class Alloc = std::allocator<T>>
+WhenAllVectorAwaiter<T, Alloc> when_all(std::vector<T, Alloc> const &tasks) {
+    return WhenAllVectorAwaiter<T, Alloc>(tasks);
 }
 
 } // namespace co_async
@@ -1,16 +1,16 @@
 #pragma once
 
-#include "co_async/debug.hpp"
 #include <coroutine>
-#include <span>
+#include <cstddef>
 #include <exception>
+#include <stdexcept>
 #include <vector>
+#include <tuple>
 #include <variant>
 #include <type_traits>
-#include <co_async/uninitialized.hpp>
-#include <co_async/task.hpp>
-#include <co_async/return_previous.hpp>
+#include <utility>
 #include <co_async/concepts.hpp>
+#include <co_async/when_child.hpp>
 
 namespace co_async {
 
@@ -18,89 +18,195 @@ struct WhenAnyCtlBlock {
     static constexpr std::size_t kNullIndex = std::size_t(-1);
 
     std::size_t mIndex{kNullIndex};
-    std::coroutine_handle<> mPrevious{};
+    WhenContinuation mParent;
     std::exception_ptr mException{};
+
+    // 启动期间 mParent 为空，见 WhenAllCtlBlock::complete；
+    // 只有最先完成的子任务算数
+    std::coroutine_handle<> complete(std::size_t index) noexcept {
+        if (done()) {
+            return nullptr;
+        }
+        mIndex = index;
+        return mParent.take();
+    }
+
+    bool done() const noexcept {
+        return mIndex != kNullIndex;
+    }
 };
 
+// 最先完成 (或抛出异常) 的子任务决定结果，其余子任务未启动的不再启动，
+// 已启动的随本对象销毁，即 co_await 所在的完整表达式结束时
+template <class... Ts>
 struct WhenAnyAwaiter {
+    explicit WhenAnyAwaiter(Ts &&...ts) : mTasks(std::forward<Ts>(ts)...) {}
+
+    WhenAnyAwaiter(WhenAnyAwaiter &&that) : mTasks(std::move(that.mTasks)) {}
+
     bool await_ready() const noexcept {
         return false;
     }
 
-    std::coroutine_handle<>
-    await_suspend(std::coroutine_handle<> coroutine) const {
-        if (mTasks.empty())
-            return coroutine;
-        mControl.mPrevious = coroutine;
-        for (auto const &t: mTasks.subspan(0, mTasks.size() - 1))
-            t.mCoroutine.resume();
-        return mTasks.back().mCoroutine;
+    template <class P>
+    bool await_suspend(std::coroutine_handle<P> coroutine) {
+        inherit_stop_token(stopTokenOf(coroutine));
+        launch(std::make_index_sequence<sizeof...(Ts)>());
+        if (mControl.done()) {
+            return false;
+        }
+        mControl.mParent.mPrevious = coroutine;
+        return true;
+    }
+
+    // 作为外层组合器的子任务时由外层启动，结束时调用 hook
+    std::coroutine_handle<> await_hook(CompletionHook *hook) {
+        launch(std::make_index_sequence<sizeof...(Ts)>());
+        if (mControl.done()) {
+            return hook->mCallback(*hook);
+        }
+        mControl.mParent.mHook = hook;
+        return std::noop_coroutine();
     }
 
-    void await_resume() const {
+    std::variant<typename AwaitableTraits<Ts>::NonVoidRetType...>
+    await_resume() {
         if (mControl.mException) [[unlikely]] {
             std::rethrow_exception(mControl.mException);
         }
+        return result(std::make_index_sequence<sizeof...(Ts)>());
     }
 
-    WhenAnyCtlBlock &mControl;
-    std::span<ReturnPreviousTask const> mTasks;
-};
+    // 本对象作为借用的子任务被外层组合器放弃时调用
+    void detach() noexcept {
+        mControl.mParent.reset();
+    }
 
-template <class T>
-ReturnPreviousTask whenAnyHelper(auto &&t, WhenAnyCtlBlock &control,
-                                 Uninitialized<T> &result, std::size_t index) {
-    try {
-        result.putValue(
-            (co_await std::forward<decltype(t)>(t), NonVoidHelper<>()));
-    } catch (...) {
-        control.mException = std::current_exception();
-        co_return control.mPrevious;
-    }
-    control.mIndex = index;
-    co_return control.mPrevious;
-}
+    // 作为外层组合器的子任务时由外层传入，子任务都沿用这个 StopToken
+    void inherit_stop_token(StopToken token) noexcept {
+        if (!mStopToken.stop_possible()) {
+            mStopToken = token;
+        }
+    }
 
-template <std::size_t... Is, class... Ts>
-Task<std::variant<typename AwaitableTraits<Ts>::NonVoidRetType...>>
-whenAnyImpl(std::index_sequence<Is...>, Ts &&...ts) {
-    WhenAnyCtlBlock control{};
-    std::tuple<Uninitialized<typename AwaitableTraits<Ts>::RetType>...> result;
-    ReturnPreviousTask taskArray[]{
-        whenAnyHelper(ts, control, std::get<Is>(result), Is)...};
-    co_await WhenAnyAwaiter(control, taskArray);
-    Uninitialized<std::variant<typename AwaitableTraits<Ts>::NonVoidRetType...>>
-        varResult;
-    ((control.mIndex == Is &&
-      (varResult.putValue(std::in_place_index<Is>,
-                          std::get<Is>(result).moveValue()),
-       0)),
-     ...);
-    co_return varResult.moveValue();
-}
+private:
+    template <std::size_t... Is>
+    void launch(std::index_sequence<Is...>) {
+        (void)((std::get<Is>(mChildren).start(std::get<Is>(mTasks), mControl,
+                                              Is, mStopToken),
+                !mControl.done()) &&
+               ...);
+    }
+
+    template <std::size_t I, std::size_t... Is>
+    std::variant<typename AwaitableTraits<Ts>::NonVoidRetType...>
+    result(std::index_sequence<I, Is...>) {
+        if constexpr (sizeof...(Is) != 0) {
+            if (mControl.mIndex != I) {
+                return result(std::index_sequence<Is...>());
+            }
+        }
+        return std::variant<typename AwaitableTraits<Ts>::NonVoidRetType...>(
+            std::in_place_index<I>, std::get<I>(mChildren).moveResult());
+    }
+
+    std::tuple<Ts...> mTasks;
+    WhenAnyCtlBlock mControl;
+    StopToken mStopToken{};
+    std::tuple<WhenChild<std::remove_reference_t<Ts>, WhenAnyCtlBlock>...>
+        mChildren;
+};
 
 template <Awaitable... Ts>
     requires(sizeof...(Ts) != 0)
-auto when_any(Ts &&...ts) {
-    return whenAnyImpl(std::make_index_sequence<sizeof...(Ts)>{},
-                       std::forward<Ts>(ts)...);
+WhenAnyAwaiter<Ts...> when_any(Ts &&...ts) {
+    return WhenAnyAwaiter<Ts...>(std::forward<Ts>(ts)...);
 }
 
-template <Awaitable T, class Alloc = std::allocator<T>>
-Task<typename AwaitableTraits<T>::RetType>
-when_any(std::vector<T, Alloc> const &tasks) {
-    WhenAnyCtlBlock control{tasks.size()};
-    Alloc alloc = tasks.get_allocator();
-    Uninitialized<typename AwaitableTraits<T>::RetType> result;
-    {
-        std::vector<ReturnPreviousTask, Alloc> taskArray(alloc);
-        taskArray.reserve(tasks.size());
-        for (auto &task: tasks) {
-            taskArray.push_back(whenAllHelper(task, control, result));
+// 不多于 N 个子任务时不分配内存
+template <class T, class Alloc, std::size_t N = 16>
+struct WhenAnyVectorAwaiter {
+    using RetType = typename AwaitableTraits<T const>::RetType;
+
+    explicit WhenAnyVectorAwaiter(std::vector<T, Alloc> const &tasks)
+        : mTasks(tasks),
+          mChildren(tasks.size()) {}
+
+    WhenAnyVectorAwaiter(WhenAnyVectorAwaiter &&that)
+        : mTasks(that.mTasks),
+          mChildren(that.mTasks.size()) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    template <class P>
+    bool await_suspend(std::coroutine_handle<P> coroutine) {
+        inherit_stop_token(stopTokenOf(coroutine));
+        if (launch()) {
+            return false;
+        }
+        mControl.mParent.mPrevious = coroutine;
+        return true;
+    }
+
+    std::coroutine_handle<> await_hook(CompletionHook *hook) {
+        if (launch()) {
+            return hook->mCallback(*hook);
+        }
+        mControl.mParent.mHook = hook;
+        return std::noop_coroutine();
+    }
+
+    RetType await_resume() {
+        if (mControl.mException) [[unlikely]] {
+            std::rethrow_exception(mControl.mException);
+        }
+        if constexpr (!std::is_void_v<RetType>) {
+            return mChildren[mControl.mIndex].moveResult();
+        }
+    }
+
+    // 胜出的子任务在 vector 中的下标
+    std::size_t index() const noexcept {
+        return mControl.mIndex;
+    }
+
+    // 本对象作为借用的子任务被外层组合器放弃时调用
+    void detach() noexcept {
+        mControl.mParent.reset();
+    }
+
+    void inherit_stop_token(StopToken token) noexcept {
+        if (!mStopToken.stop_possible()) {
+            mStopToken = token;
+        }
+    }
+
+private:
+    // 依次启动子任务直到有一个完成，返回是否已经完成
+    bool launch() {
+        for (std::size_t i = 0; i < mTasks.size(); ++i) {
+            mChildren[i].start(mTasks[i], mControl, i, mStopToken);
+            if (mControl.done()) {
+                return true;
+            }
         }
-        co_await WhenAnyAwaiter(control, taskArray);
+        return false;
+    }
+
+    std::vector<T, Alloc> const &mTasks;
+    WhenAnyCtlBlock mControl;
+    StopToken mStopToken{};
+    WhenChildArray<WhenChild<T const, WhenAnyCtlBlock>, N> mChildren;
+};
+
+template <Awaitable T, class Alloc = std::allocator<T>>
+WhenAnyVectorAwaiter<T, Alloc> when_any(std::vector<T, Alloc> const &tasks) {
+    if (tasks.empty()) [[unlikely]] {
+        throw std::invalid_argument("when_any of no awaitables");
     }
-    co_return result.moveValue();
+    return WhenAnyVectorAwaiter<T, Alloc>(tasks);
 }
 
 } // namespace co_async
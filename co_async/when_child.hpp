@@ -0,0 +1,275 @@
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <co_async/concepts.hpp>
+#include <co_async/non_void_helper.hpp>
+#include <co_async/previous_awaiter.hpp>
+#include <co_async/stop_token.hpp>
+
+namespace co_async {
+
+// 支持完成回调的 awaiter (Task 的) 由 await_hook 启动，不需要 continuation
+template <class A>
+concept HookAwaiter = requires(A &a, CompletionHook *hook) {
+    { a.await_hook(hook) } -> std::convertible_to<std::coroutine_handle<>>;
+};
+
+// 其他 awaiter 只接受协程句柄，为它创建一个真正的协程帧作为 continuation：
+// 被恢复时调用 hook 并跳转到 hook 返回的协程，之后停在那里直到随本对象销毁。
+// 只有这种子任务 (如嵌套的组合器) 需要分配内存
+struct [[nodiscard]] WhenTrampoline {
+    struct promise_type {
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        void unhandled_exception() noexcept {}
+
+        void return_void() noexcept {}
+
+        WhenTrampoline get_return_object() noexcept {
+            return WhenTrampoline(
+                std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+
+    struct JumpAwaiter {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<>) const noexcept {
+            return mHook.mCallback(mHook);
+        }
+
+        void await_resume() const noexcept {}
+
+        CompletionHook &mHook;
+    };
+
+    static WhenTrampoline make(CompletionHook &hook) {
+        co_await JumpAwaiter(hook);
+    }
+
+    WhenTrampoline() = default;
+
+    explicit WhenTrampoline(std::coroutine_handle<> coroutine) noexcept
+        : mCoroutine(coroutine) {}
+
+    WhenTrampoline(WhenTrampoline &&that) noexcept
+        : mCoroutine(std::exchange(that.mCoroutine, nullptr)) {}
+
+    WhenTrampoline &operator=(WhenTrampoline &&that) noexcept {
+        std::swap(mCoroutine, that.mCoroutine);
+        return *this;
+    }
+
+    ~WhenTrampoline() {
+        if (mCoroutine) {
+            mCoroutine.destroy();
+        }
+    }
+
+    std::coroutine_handle<> handle() const noexcept {
+        return mCoroutine;
+    }
+
+private:
+    std::coroutine_handle<> mCoroutine;
+};
+
+// 组合器结束时要恢复的对象：等待者的协程，或者作为外层组合器 (或
+// and_then) 的子任务时外层的完成回调；只交出一次
+struct WhenContinuation {
+    std::coroutine_handle<> mPrevious{};
+    CompletionHook *mHook{};
+
+    // 返回需要恢复的协程，没有时返回空
+    std::coroutine_handle<> take() noexcept {
+        if (auto *hook = std::exchange(mHook, nullptr)) {
+            return hook->mCallback(*hook);
+        }
+        return std::exchange(mPrevious, nullptr);
+    }
+
+    void reset() noexcept {
+        mPrevious = nullptr;
+        mHook = nullptr;
+    }
+};
+
+template <class T>
+struct WhenResult {
+    using Type = std::remove_cvref_t<T>;
+};
+
+template <class T>
+struct WhenResult<T &> {
+    using Type = std::reference_wrapper<T>;
+};
+
+template <>
+struct WhenResult<void> {
+    using Type = NonVoidHelper<>;
+};
+
+// 本身就是 Awaiter 的子任务直接使用，否则调用 operator co_await
+template <class A>
+struct WhenAwaiterOf {
+    using Type = std::remove_cvref_t<
+        decltype(std::declval<A &>().operator co_await())>;
+
+    static Type get(A &a) {
+        return a.operator co_await();
+    }
+
+    static Type &unwrap(Type &t) noexcept {
+        return t;
+    }
+};
+
+template <Awaiter A>
+struct WhenAwaiterOf<A> {
+    using Type = std::reference_wrapper<A>;
+
+    static Type get(A &a) noexcept {
+        return a;
+    }
+
+    static A &unwrap(Type &t) noexcept {
+        return t.get();
+    }
+};
+
+// 一个子任务的状态，存放在组合器的 awaiter 中；Ctl 为控制块，
+// 其 complete(index) 返回需要恢复的父协程，不需要恢复时返回空
+template <class A, class Ctl>
+struct WhenChild : CompletionHook {
+    using AwaiterOf = WhenAwaiterOf<A>;
+    using RetType = typename AwaitableTraits<A>::RetType;
+
+    WhenChild() noexcept : CompletionHook{&WhenChild::onComplete} {}
+
+    WhenChild(WhenChild &&) = delete;
+
+    // 借用的子任务 (左值或 vector 中的) 可能比 awaiter 活得久，
+    // 让它们以后完成时不再跳回这里
+    ~WhenChild() {
+        if (mPending) {
+            auto &awaiter = AwaiterOf::unwrap(*mAwaiter);
+            if constexpr (requires { awaiter.detach(); }) {
+                awaiter.detach();
+            }
+        }
+    }
+
+    // 子任务同步完成时不恢复父协程，由调用者检查控制块；
+    // 子任务沿用 token，即组合器的等待者的 StopToken
+    void start(A &a, Ctl &control, std::size_t index, StopToken token = {}) {
+        mControl = &control;
+        mIndex = index;
+        auto &awaiter = AwaiterOf::unwrap(mAwaiter.emplace(AwaiterOf::get(a)));
+        inheritStopToken(awaiter, token);
+        if (awaiter.await_ready()) {
+            finish();
+            return;
+        }
+        mPending = true;
+        if constexpr (HookAwaiter<std::remove_reference_t<decltype(awaiter)>>) {
+            awaiter.await_hook(this).resume();
+        } else {
+            mTrampoline = WhenTrampoline::make(*this);
+            auto handle = mTrampoline.handle();
+            using Suspend = decltype(awaiter.await_suspend(handle));
+            if constexpr (std::is_void_v<Suspend>) {
+                awaiter.await_suspend(handle);
+            } else if constexpr (std::is_same_v<Suspend, bool>) {
+                if (!awaiter.await_suspend(handle)) {
+                    finish();
+                }
+            } else {
+                awaiter.await_suspend(handle).resume();
+            }
+        }
+    }
+
+    typename WhenResult<RetType>::Type moveResult() {
+        return std::move(*mResult);
+    }
+
+    bool pending() const noexcept {
+        return mPending;
+    }
+
+    // 调用者随后自行销毁未完成的子任务，析构时不必再 detach
+    void forget() noexcept {
+        mPending = false;
+    }
+
+    std::optional<typename WhenResult<RetType>::Type> mResult;
+
+private:
+    std::coroutine_handle<> finish() noexcept {
+        mPending = false;
+        try {
+            auto &awaiter = AwaiterOf::unwrap(*mAwaiter);
+            if constexpr (std::is_void_v<RetType>) {
+                awaiter.await_resume();
+                mResult.emplace();
+            } else {
+                mResult.emplace(awaiter.await_resume());
+            }
+        } catch (...) {
+            mControl->mException = std::current_exception();
+        }
+        return mControl->complete(mIndex);
+    }
+
+    // 跳转到父协程后本对象可能已随 awaiter 销毁，返回前不能再访问
+    static std::coroutine_handle<> onComplete(CompletionHook &hook) noexcept {
+        if (auto previous = static_cast<WhenChild &>(hook).finish()) {
+            return previous;
+        }
+        return std::noop_coroutine();
+    }
+
+    Ctl *mControl{};
+    std::size_t mIndex{};
+    bool mPending = false;
+    std::optional<typename AwaiterOf::Type> mAwaiter;
+    WhenTrampoline mTrampoline;
+};
+
+// 子任务不多于 N 个时存放在对象内部，否则分配在堆上
+template <class Child, std::size_t N>
+struct WhenChildArray {
+    explicit WhenChildArray(std::size_t n) {
+        if (n > N) {
+            mHeap = std::make_unique<Child[]>(n);
+        }
+    }
+
+    Child &operator[](std::size_t i) noexcept {
+        return mHeap ? mHeap[i] : mInline[i];
+    }
+
+private:
+    std::array<Child, N> mInline;
+    std::unique_ptr<Child[]> mHeap;
+};
+
+} // namespace co_async